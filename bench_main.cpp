@@ -0,0 +1,491 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <QTextStream>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <thread>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "datasetdir.h"
+#include "framedecoder.h"
+#include "framepool.h"
+#include "framerenderer.h"
+#include "imageformat.h"
+#include "keyframeindex.h"
+
+// vdt-bench: the tool's hot paths on generated footage, as JSON, so two
+// builds can be compared run against run.
+//   vdt-bench --json before.json
+//   vdt-bench --quick --json after.json
+//   vdt-bench --dir-sizes 10000,100000,1000000
+// Videos and file trees are generated once into --work and reused; the
+// content is seeded, so every machine benchmarks the same pixels.
+
+namespace {
+
+struct VideoSpec
+{
+    int width = 0;
+    int height = 0;
+    QString fourcc;      // mp4v, avc1, MJPG
+    QString extension;
+    int gop = 0;         // requested keyframe interval, 1 = intra only
+    int frames = 0;
+
+    QString name() const
+    {
+        return QString("synth_%1p_%2_g%3_%4f.%5").arg(height).arg(fourcc).arg(gop).arg(frames).arg(extension);
+    }
+};
+
+// Deterministic, encoder-unfriendly enough to look like footage: moving
+// gradient, a few moving shapes, the frame number and seeded noise
+void drawSyntheticFrame(cv::Mat &frame, int index)
+{
+    const int w = frame.cols, h = frame.rows;
+    for (int y = 0; y < h; ++y)
+    {
+        cv::Vec3b *row = frame.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < w; ++x)
+            row[x] = cv::Vec3b(static_cast<uchar>((x + index * 3) * 255 / w),
+                               static_cast<uchar>((y + index * 2) * 255 / h),
+                               static_cast<uchar>(((x + y) / 4 + index) & 0xff));
+    }
+    for (int i = 0; i < 6; ++i)
+    {
+        const int cx = (w / 7 * (i + 1) + index * (i + 2) * 3) % w;
+        const int cy = (h / 2 + static_cast<int>(h / 3 * std::sin((index + i * 20) / 15.0)));
+        cv::circle(frame, cv::Point(cx, cy), h / 12 + i * 4, cv::Scalar(40 * i, 255 - 30 * i, 128), cv::FILLED);
+    }
+    cv::putText(frame, std::to_string(index), cv::Point(w / 20, h / 6), cv::FONT_HERSHEY_SIMPLEX,
+                h / 200.0, cv::Scalar(255, 255, 255), std::max(1, h / 150));
+
+    cv::Mat noise(frame.size(), frame.type());
+    cv::RNG rng(static_cast<uint64>(index) + 1);
+    rng.fill(noise, cv::RNG::NORMAL, 0, 6);
+    cv::add(frame, noise, frame);
+}
+
+// Writes the video unless a complete copy is already there
+bool ensureVideo(const QString &path, const VideoSpec &spec, QTextStream &err)
+{
+    if (QFileInfo(path).size() > 0 && QFile::exists(path + ".done")) return true;
+
+    // The FFmpeg writer takes codec options from the environment (g = GOP length)
+    qputenv("OPENCV_FFMPEG_WRITER_OPTIONS", QString("g;%1").arg(spec.gop).toLatin1());
+    const QByteArray cc = spec.fourcc.toLatin1();
+    cv::VideoWriter writer(path.toStdString(), cv::VideoWriter::fourcc(cc[0], cc[1], cc[2], cc[3]),
+                           30.0, cv::Size(spec.width, spec.height));
+    qunsetenv("OPENCV_FFMPEG_WRITER_OPTIONS");
+    if (!writer.isOpened()) return false;
+
+    err << "Generating " << spec.name() << "...\n";
+    err.flush();
+    cv::Mat frame(spec.height, spec.width, CV_8UC3);
+    for (int i = 0; i < spec.frames; ++i)
+    {
+        drawSyntheticFrame(frame, i);
+        writer.write(frame);
+    }
+    writer.release();
+
+    QFile done(path + ".done");
+    return done.open(QIODevice::WriteOnly);
+}
+
+double msSince(const std::chrono::steady_clock::time_point &t0)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+QJsonObject summarize(std::vector<double> ms)
+{
+    QJsonObject o;
+    o["n"] = static_cast<int>(ms.size());
+    if (ms.empty()) return o;
+    std::sort(ms.begin(), ms.end());
+    auto pct = [&ms](double p) {
+        const size_t i = std::min(ms.size() - 1, static_cast<size_t>(p * (ms.size() - 1) + 0.5));
+        return ms[i];
+    };
+    o["p50_ms"] = pct(0.50);
+    o["p99_ms"] = pct(0.99);
+    o["mean_ms"] = std::accumulate(ms.begin(), ms.end(), 0.0) / ms.size();
+    o["max_ms"] = ms.back();
+    return o;
+}
+
+// Next frame the decoder hands out at or after `index` (seeks may land late
+// on backends without exact positioning). -1 on timeout.
+int waitForFrame(FrameDecoder &decoder, int index, DecodedFrame &out, int timeoutMs = 10000)
+{
+    QElapsedTimer t;
+    t.start();
+    while (t.elapsed() < timeoutMs)
+    {
+        if (decoder.takeFrame(out))
+        {
+            if (out.index >= index) return out.index;
+            continue;
+        }
+        if (decoder.atEnd()) return -1;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return -1;
+}
+
+// MainWindow::seekTo() minus the display: ring, then cache, then a real seek
+std::vector<double> benchBackSteps(FrameDecoder &decoder, int start, int steps)
+{
+    std::vector<double> ms;
+    DecodedFrame f;
+    cv::Mat cached;
+    for (int i = 0; i < steps; ++i)
+    {
+        const int target = start - i;
+        const auto t0 = std::chrono::steady_clock::now();
+        if (!decoder.takeFrameAt(target, f) && !decoder.cache().find(target, cached))
+        {
+            decoder.seek(target);
+            if (waitForFrame(decoder, target, f) < 0) continue;
+        }
+        ms.push_back(msSince(t0));
+    }
+    return ms;
+}
+
+QJsonObject benchVideo(const QString &path, const VideoSpec &spec, int seeks, QTextStream &err)
+{
+    QJsonObject o;
+    o["name"] = spec.name();
+    o["width"] = spec.width;
+    o["height"] = spec.height;
+    o["codec"] = spec.fourcc;
+    o["gop_requested"] = spec.gop;
+    o["frames"] = spec.frames;
+
+    err << "Benchmarking " << spec.name() << "...\n";
+    err.flush();
+
+    // What the writer really did (keyframe index is built the same way the GUI does;
+    // packets only, without packet reading there is nothing to count: -1)
+    const KeyframeIndex index = KeyframeIndex::loadOrBuild(path);
+    o["keyframes"] = index.hasKeyframes() ? static_cast<int>(index.keyframes().size()) : -1;
+
+    FrameDecoder decoder;
+    decoder.setCapacity(16);
+    decoder.cache().setBudgetBytes(0);   // every seek below has to decode
+    if (!decoder.open(path))
+    {
+        o["error"] = "open failed";
+        return o;
+    }
+    const int frames = std::max(1, decoder.frameCount());
+
+    // Sequential decode through the player's ring
+    {
+        DecodedFrame f;
+        int decoded = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        while (waitForFrame(decoder, 0, f) >= 0)
+            ++decoded;
+        const double ms = msSince(t0);
+        o["decode_fps"] = ms > 0.0 ? decoded * 1000.0 / ms : 0.0;
+        o["decoded_frames"] = decoded;
+    }
+
+    // Wait for the decoder's own index so seeks take the keyframe path
+    for (int i = 0; i < 500 && !decoder.keyframeIndex(); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> pick(0, frames - 1);
+
+    // Random seeks, what a slider release does
+    {
+        std::vector<double> ms;
+        DecodedFrame f;
+        for (int i = 0; i < seeks; ++i)
+        {
+            const int target = pick(rng);
+            const auto t0 = std::chrono::steady_clock::now();
+            decoder.seek(target);
+            if (waitForFrame(decoder, target, f) >= 0)
+                ms.push_back(msSince(t0));
+        }
+        o["seek"] = summarize(ms);
+    }
+
+    // Stepping backwards (left arrow while paused), through the GUI's path:
+    // cold = nothing cached, one keyframe seek per step; warm = the default
+    // cache budget after the idle filler had its go around the play head
+    const int start = std::max(1, frames / 2);
+    const int steps = std::min(seeks, start);
+    o["back_step_cold"] = summarize(benchBackSteps(decoder, start, steps));
+
+    decoder.cache().setBudgetBytes(FrameCache().budgetBytes());
+    {
+        DecodedFrame f;
+        decoder.seek(start);
+        waitForFrame(decoder, start, f);
+        decoder.setIdleCenter(start);
+        // Until the steps are covered or the filler stopped (budget full, no keyframes)
+        QElapsedTimer t, still;
+        t.start();
+        still.start();
+        size_t bytes = decoder.cache().bytes();
+        while (t.elapsed() < 10000 && still.elapsed() < 500 && !decoder.cache().contains(start - steps + 1))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            if (decoder.cache().bytes() != bytes)
+            {
+                bytes = decoder.cache().bytes();
+                still.restart();
+            }
+        }
+        o["back_step_fill_ms"] = static_cast<int>(t.elapsed());
+    }
+    o["back_step"] = summarize(benchBackSteps(decoder, start, steps));
+    decoder.setIdleCenter(-1);
+
+    // Display: downscale + colour into the label image, and the plain full-size conversion
+    {
+        decoder.seek(0);
+        DecodedFrame f;
+        FrameRenderer renderer;
+        QImage full;
+        std::vector<double> renderMs, convertMs;
+        for (int i = 0; i < 60 && waitForFrame(decoder, 0, f) >= 0; ++i)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            renderer.render(f.bgr, QSize(1280, 720));
+            renderMs.push_back(msSince(t0));
+
+            t0 = std::chrono::steady_clock::now();
+            FrameRenderer::matToQImage(f.bgr, full);
+            convertMs.push_back(msSince(t0));
+        }
+        o["render_720p"] = summarize(renderMs);
+        o["mat_to_qimage"] = summarize(convertMs);
+    }
+
+    decoder.close();
+    return o;
+}
+
+// What the save path costs per frame: encode + exclusive write, per format
+QJsonArray benchSave(const QString &workDir, const cv::Mat &frame, int count)
+{
+    QJsonArray results;
+    for (const QString &spec : { QString("png"), QString("jpg:92"), QString("webp:90"), QString("ppm") })
+    {
+        ImageFormat format;
+        if (!ImageFormat::parse(spec, format)) continue;
+
+        QDir dir(workDir + "/save_" + format.codec);
+        dir.removeRecursively();
+        QDir().mkpath(dir.absolutePath());
+
+        std::vector<double> ms;
+        qint64 bytes = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            const QString path = dir.filePath(DatasetDir::imageFileName(i + 1, format.extension()));
+            const auto t0 = std::chrono::steady_clock::now();
+            if (DatasetDir::writeImageExclusive(path, frame, format.params()) != DatasetDir::Written) break;
+            ms.push_back(msSince(t0));
+            bytes += QFileInfo(path).size();
+        }
+        dir.removeRecursively();
+
+        QJsonObject o = summarize(ms);
+        o["format"] = format.toString();
+        o["width"] = frame.cols;
+        o["height"] = frame.rows;
+        o["bytes_per_frame"] = ms.empty() ? 0.0 : double(bytes) / ms.size();
+        results.append(o);
+    }
+    return results;
+}
+
+// Save directory with `files` empty images (only names matter for the scan)
+bool ensureTree(const QString &dirPath, int files, QTextStream &err)
+{
+    if (QFile::exists(dirPath + "/.done")) return true;
+
+    err << "Generating " << files << " files in " << dirPath << "...\n";
+    err.flush();
+    QDir(dirPath).removeRecursively();
+    if (!QDir().mkpath(dirPath)) return false;
+    for (int i = 1; i <= files; ++i)
+    {
+        QFile f(dirPath + "/" + DatasetDir::imageFileName(i, i % 4 ? "png" : "jpg"));
+        if (!f.open(QIODevice::WriteOnly)) return false;
+    }
+    QFile done(dirPath + "/.done");
+    return done.open(QIODevice::WriteOnly);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Own name: the keyframe cache of synthetic clips doesn't belong in the GUI's
+    app.setApplicationName("vdt-bench");
+    app.setApplicationVersion("1.0");
+    app.setOrganizationName("Dataset Tools");
+
+    QTextStream err(stderr);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark decode, seek, display, save and directory scan on generated videos.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption workOpt("work", "Where generated videos and file trees are kept (default: temp dir).", "dir");
+    QCommandLineOption jsonOpt("json", "Write the results to this file (default: stdout).", "file");
+    QCommandLineOption quickOpt("quick", "720p only, fewer codecs and frames.");
+    QCommandLineOption framesOpt("frames", "Frames per generated video (default: 300).", "n");
+    QCommandLineOption seeksOpt("seeks", "Random seeks / back steps per video (default: 50).", "n");
+    QCommandLineOption dirOpt("dir-sizes", "File counts for the directory scan (default: 10000,100000).", "list");
+    QCommandLineOption with4kOpt("4k", "Also generate and test 2160p.");
+    parser.addOptions({ workOpt, jsonOpt, quickOpt, framesOpt, seeksOpt, dirOpt, with4kOpt });
+    parser.process(app);
+
+    const bool quick = parser.isSet(quickOpt);
+    const QString work = parser.isSet(workOpt)
+                             ? parser.value(workOpt)
+                             : QStandardPaths::writableLocation(QStandardPaths::TempLocation) + "/vdt-bench";
+    QDir().mkpath(work);
+    const int frames = parser.isSet(framesOpt) ? std::max(30, parser.value(framesOpt).toInt()) : (quick ? 120 : 300);
+    const int seeks = parser.isSet(seeksOpt) ? std::max(1, parser.value(seeksOpt).toInt()) : (quick ? 20 : 50);
+
+    QList<QSize> sizes = quick ? QList<QSize>{ { 1280, 720 } }
+                               : QList<QSize>{ { 640, 360 }, { 1280, 720 }, { 1920, 1080 } };
+    if (parser.isSet(with4kOpt)) sizes << QSize(3840, 2160);
+
+    struct Codec { const char *fourcc; const char *ext; int gop; };
+    const QList<Codec> codecs = quick ? QList<Codec>{ { "mp4v", "mp4", 250 }, { "MJPG", "avi", 1 } }
+                                      : QList<Codec>{ { "mp4v", "mp4", 12 }, { "mp4v", "mp4", 250 },
+                                                      { "avc1", "mp4", 250 }, { "MJPG", "avi", 1 } };
+
+    QJsonObject root;
+    root["version"] = 1;
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    QJsonObject host;
+    host["cpu"] = QSysInfo::currentCpuArchitecture();
+    host["threads"] = static_cast<int>(std::thread::hardware_concurrency());
+    host["os"] = QSysInfo::prettyProductName();
+    host["opencv"] = QString::fromStdString(cv::getVersionString());
+    host["qt"] = QString(qVersion());
+    root["host"] = host;
+
+    QJsonArray videos;
+    cv::Mat saveSample;
+    for (const QSize &size : sizes)
+    {
+        for (const Codec &c : codecs)
+        {
+            VideoSpec spec;
+            spec.width = size.width();
+            spec.height = size.height();
+            spec.fourcc = c.fourcc;
+            spec.extension = c.ext;
+            spec.gop = c.gop;
+            spec.frames = frames;
+
+            const QString path = work + "/" + spec.name();
+            if (!ensureVideo(path, spec, err))
+            {
+                err << "Skipping " << spec.name() << ": no " << spec.fourcc << " writer in this OpenCV build\n";
+                continue;
+            }
+            videos.append(benchVideo(path, spec, seeks, err));
+
+            // Save path is measured on the largest footage we have
+            if (saveSample.empty() || saveSample.cols < spec.width)
+            {
+                saveSample.create(spec.height, spec.width, CV_8UC3);
+                drawSyntheticFrame(saveSample, frames / 2);
+            }
+        }
+    }
+    root["videos"] = videos;
+
+    if (!saveSample.empty())
+    {
+        err << "Benchmarking save...\n";
+        root["save"] = benchSave(work, saveSample, quick ? 10 : 30);
+    }
+
+    QJsonArray scans;
+    const QStringList dirSizes = (parser.isSet(dirOpt) ? parser.value(dirOpt) : QString(quick ? "10000" : "10000,100000"))
+                                     .split(',', Qt::SkipEmptyParts);
+    for (const QString &s : dirSizes)
+    {
+        const int files = s.trimmed().toInt();
+        if (files <= 0) continue;
+        const QString dir = work + QString("/dir_%1").arg(files);
+        if (!ensureTree(dir, files, err)) continue;
+
+        // Best of three: the first run also measures a cold directory cache
+        std::vector<double> ms;
+        int largest = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            largest = DatasetDir::extractLargestNumberInDir(dir);
+            ms.push_back(msSince(t0));
+        }
+        QJsonObject o;
+        o["files"] = files;
+        o["first_ms"] = ms.front();
+        o["best_ms"] = *std::min_element(ms.begin(), ms.end());
+        o["largest"] = largest;
+        scans.append(o);
+    }
+    root["dir_scan"] = scans;
+
+    const FramePool::Stats pool = FramePool::shared().stats();
+    QJsonObject poolStats;
+    poolStats["acquired"] = static_cast<qint64>(pool.acquired);
+    poolStats["allocated"] = static_cast<qint64>(pool.allocated);
+    poolStats["pooled_mb"] = pool.bytes / (1024.0 * 1024.0);
+    root["frame_pool"] = poolStats;
+
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+    if (parser.isSet(jsonOpt))
+    {
+        QFile f(parser.value(jsonOpt));
+        if (!f.open(QIODevice::WriteOnly) || f.write(json) != json.size())
+        {
+            err << "Could not write " << parser.value(jsonOpt) << "\n";
+            return 1;
+        }
+        err << "Results written to " << parser.value(jsonOpt) << "\n";
+    }
+    else
+    {
+        out << json;
+    }
+    return 0;
+}
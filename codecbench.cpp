@@ -0,0 +1,81 @@
+#include "codecbench.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+
+std::vector<cv::Mat> CodecBench::sampleFrames(const QStringList &videos, int count)
+{
+    std::vector<cv::Mat> frames;
+    if (videos.isEmpty() || count <= 0) return frames;
+
+    const int perVideo = std::max(1, (count + static_cast<int>(videos.size()) - 1) / static_cast<int>(videos.size()));
+    for (const QString &path : videos)
+    {
+        cv::VideoCapture cap(path.toStdString());
+        if (!cap.isOpened()) continue;
+
+        // Spread over the whole clip: first seconds are often black or a title card
+        const int total = std::max(1, static_cast<int>(cap.get(cv::CAP_PROP_FRAME_COUNT)));
+        for (int i = 0; i < perVideo && static_cast<int>(frames.size()) < count; ++i)
+        {
+            cap.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(total) * (i + 0.5) / perVideo);
+            cv::Mat frame;
+            if (!cap.read(frame) || frame.empty()) break;
+            frames.push_back(frame);
+        }
+    }
+    return frames;
+}
+
+CodecBenchResult CodecBench::run(const std::vector<cv::Mat> &frames, const ImageFormat &format, int threads)
+{
+    CodecBenchResult r;
+    r.format = format;
+    if (frames.empty()) return r;
+
+    const std::string ext = "." + format.extension().toStdString();
+    const std::vector<int> params = format.params();
+    if (!cv::haveImageWriter(ext)) return r;
+
+    if (threads <= 0) threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threads = std::min(threads, static_cast<int>(frames.size()));
+
+    std::atomic<size_t> next{0};
+    std::atomic<qint64> encoded{0};
+    std::atomic<bool> failed{false};
+
+    QElapsedTimer t;
+    t.start();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([&]() {
+            std::vector<uchar> buf;   // reused, like a real encoder thread would
+            for (size_t k = next++; k < frames.size(); k = next++)
+            {
+                try {
+                    if (!cv::imencode(ext, frames[k], buf, params)) failed = true;
+                } catch (const cv::Exception &) {
+                    failed = true;
+                }
+                encoded += static_cast<qint64>(buf.size());
+            }
+        });
+    }
+    for (std::thread &w : workers)
+        w.join();
+    r.seconds = t.nsecsElapsed() / 1e9;
+
+    r.ok = !failed;
+    r.frames = static_cast<int>(frames.size());
+    r.encodedBytes = encoded;
+    for (const cv::Mat &m : frames)
+        r.rawBytes += static_cast<qint64>(m.total() * m.elemSize());
+    return r;
+}
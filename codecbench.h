@@ -0,0 +1,37 @@
+#ifndef CODECBENCH_H
+#define CODECBENCH_H
+
+#include <QStringList>
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "imageformat.h"
+
+struct CodecBenchResult
+{
+    ImageFormat format;
+    bool ok = false;               // codec available in this OpenCV build
+    int frames = 0;
+    double seconds = 0.0;          // wall time, all threads
+    qint64 rawBytes = 0;           // BGR input
+    qint64 encodedBytes = 0;
+
+    double mbPerSec() const { return seconds > 0.0 ? rawBytes / (1024.0 * 1024.0) / seconds : 0.0; }
+    double bytesPerFrame() const { return frames > 0 ? double(encodedBytes) / frames : 0.0; }
+};
+
+// Encode real footage with each output setting to trade disk for CPU with numbers.
+// Encoding is in memory (imencode), so the disk doesn't skew the result.
+class CodecBench
+{
+public:
+    // Up to count frames spread evenly over the videos
+    static std::vector<cv::Mat> sampleFrames(const QStringList &videos, int count);
+
+    // Encode every frame once on `threads` threads (0 = one per core)
+    static CodecBenchResult run(const std::vector<cv::Mat> &frames, const ImageFormat &format, int threads = 0);
+};
+
+#endif // CODECBENCH_H
@@ -0,0 +1,124 @@
+#include "datasetdir.h"
+
+#include <QCollator>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+
+#include <algorithm>
+#include <climits>
+
+#include <opencv2/imgcodecs.hpp>
+
+QString DatasetDir::imageFileName(int index, const QString &extension)
+{
+    return QString("image_%1.%2").arg(index, 4, 10, QLatin1Char('0')).arg(extension);
+}
+
+QStringList DatasetDir::imageNameFilters()
+{
+    return { "*.jpg", "*.jpeg", "*.png", "*.bmp", "*.webp", "*.ppm" };
+}
+
+QStringList DatasetDir::shardNameFilters()
+{
+    return { "shard_*.tar" };
+}
+
+QStringList DatasetDir::videoNameFilters()
+{
+    return { "*.mp4", "*.avi", "*.mkv", "*.mov", "*.m4v", "*.webm" };
+}
+
+int DatasetDir::extractLargestNumberInDir(const QString &dirPath)
+{
+    QDir dir(dirPath);
+    if (!dir.exists()) return 0;
+
+    // Names only (no QFileInfoList) and a hand-rolled digit scan instead of a
+    // QRegularExpression per file: this runs over folders with 100k+ images
+    // A shard's name ends with the last image number it holds
+    QDirIterator it(dirPath, imageNameFilters() + shardNameFilters(), QDir::Files | QDir::NoSymLinks | QDir::Readable);
+
+    int maxNum = 0;
+    while (it.hasNext())
+    {
+        it.next();
+        const QString name = it.fileName();
+        const int dot = name.lastIndexOf('.');
+        const int end = dot < 0 ? name.size() : dot;   // completeBaseName(), without extension
+
+        qint64 num = -1;
+        for (int i = 0; i <= end; ++i)
+        {
+            const QChar c = i < end ? name.at(i) : QChar();
+            if (i < end && c.isDigit() && c.unicode() < 128)
+            {
+                // Every digit run is a candidate; runs that don't fit an int are skipped
+                if (num < 0) num = 0;
+                if (num <= INT_MAX) num = num * 10 + (c.unicode() - '0');
+            }
+            else if (num >= 0)
+            {
+                if (num <= INT_MAX) maxNum = std::max(maxNum, static_cast<int>(num));
+                num = -1;
+            }
+        }
+    }
+    return maxNum;
+}
+
+QString DatasetDir::tempFileName(const QString &stem, const QString &extension)
+{
+    // Hidden, letters-only tag: never counted by extractLargestNumberInDir(), unique per writer
+    QString tag;
+    for (int i = 0; i < 8; ++i)
+        tag += QChar('a' + QRandomGenerator::global()->bounded(26));
+    return QString(".%1.%2.%3").arg(stem, tag, extension);
+}
+
+DatasetDir::WriteResult DatasetDir::writeImageExclusive(const QString &path, const cv::Mat &image,
+                                                        const std::vector<int> &params)
+{
+    const QFileInfo target(path);
+    if (target.exists()) return AlreadyExists;
+
+    const QString tmp = target.dir().filePath(tempFileName(target.completeBaseName(), target.suffix()));
+
+    bool ok = false;
+    try {
+        ok = cv::imwrite(tmp.toStdString(), image, params);
+    } catch (const cv::Exception &) {
+        ok = false;
+    }
+    if (!ok)
+    {
+        QFile::remove(tmp);
+        return WriteFailed;
+    }
+
+    // QFile::rename() refuses to replace an existing file (no-replace rename / link on Unix)
+    if (QFile::rename(tmp, path)) return Written;
+
+    QFile::remove(tmp);
+    return QFileInfo::exists(path) ? AlreadyExists : WriteFailed;
+}
+
+QStringList DatasetDir::listVideos(const QString &dirPath, bool recursive)
+{
+    QStringList out;
+    QDirIterator it(dirPath, videoNameFilters(), QDir::Files | QDir::Readable,
+                    recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext())
+        out << it.next();
+
+    // Natural order so clip_2 comes before clip_10
+    QCollator collator;
+    collator.setNumericMode(true);
+    std::sort(out.begin(), out.end(), [&collator](const QString &a, const QString &b) {
+        return collator.compare(a, b) < 0;
+    });
+    return out;
+}
@@ -0,0 +1,45 @@
+#ifndef DATASETDIR_H
+#define DATASETDIR_H
+
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// Naming rules of a dataset folder, shared by the GUI and vdt-extract:
+// images are image_XXXX.<ext>, numbering continues after the largest number found.
+class DatasetDir
+{
+public:
+    enum WriteResult { Written, AlreadyExists, WriteFailed };
+
+    // image_0042.png (zero-padded to 4 digits)
+    static QString imageFileName(int index, const QString &extension = "png");
+
+    // Largest number in any image or shard file name in dirPath (0 if none)
+    static int extractLargestNumberInDir(const QString &dirPath);
+
+    // Image files we count when looking for the largest number
+    static QStringList imageNameFilters();
+
+    // Finished tar shards (shard_<first>-<last>.tar), see ShardWriter
+    static QStringList shardNameFilters();
+
+    // What the file dialog and the extractor accept as videos
+    static QStringList videoNameFilters();
+
+    // Hidden ".<stem>.<random letters>.<ext>" for files that get their real name later
+    static QString tempFileName(const QString &stem, const QString &extension);
+
+    // Encode to a temp file next to path, then rename without replacing:
+    // an image someone else already wrote under that name is never overwritten
+    static WriteResult writeImageExclusive(const QString &path, const cv::Mat &image,
+                                           const std::vector<int> &params = {});
+
+    // Video files in dirPath, sorted by name (optionally descending into subfolders)
+    static QStringList listVideos(const QString &dirPath, bool recursive = false);
+};
+
+#endif // DATASETDIR_H
@@ -0,0 +1,200 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include "codecbench.h"
+#include "datasetdir.h"
+#include "frameextractor.h"
+#include "framepool.h"
+#include "videocatalog.h"
+
+// vdt-extract: the GUI's capture logic without a display.
+//   vdt-extract clips/ -o dataset/ --every-seconds 2
+//   vdt-extract drive.mp4 -o dataset/ --frames 0,120,300-310
+//   vdt-extract clips/ -o dataset/ --scene-threshold 0.15
+//   vdt-extract clips/ --bench-codecs
+//   vdt-extract clips/ -r --list > catalog.csv
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Same names as the GUI so both share the keyframe cache in AppData
+    app.setApplicationName("Video Dataset Preparation Tool");
+    app.setApplicationVersion("1.0");
+    app.setOrganizationName("Dataset Tools");
+
+    QTextStream err(stderr);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Extract frames from videos into image_XXXX files, same numbering as the GUI.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("input", "Video file or directory of videos.");
+
+    QCommandLineOption outputOpt({ "o", "output" }, "Output directory.", "dir");
+    QCommandLineOption everyOpt("every", "Take every Nth frame.", "N");
+    QCommandLineOption secondsOpt("every-seconds", "Take one frame every T seconds.", "T");
+    QCommandLineOption framesOpt("frames", "Explicit frame numbers, e.g. 0,120,300-310.", "list");
+    QCommandLineOption startOpt("start", "First image number (default: continue after the largest in the output directory).", "n");
+    QCommandLineOption threadsOpt({ "j", "threads" }, "Decode + encode threads (default: one per core).", "n");
+    QCommandLineOption segmentOpt("segments", "Decode each video as N keyframe-aligned segments in parallel (default: auto).", "N");
+    QCommandLineOption manifestOpt("manifest", "Write image,video,frame rows (in frame order) to this CSV.", "file");
+    QCommandLineOption shardOpt("shard-mb", "Append images to tar shards of at most this many MB (with .idx) instead of single files.", "MB");
+    QCommandLineOption formatOpt("format", "Image format: png[:0-9], jpg[:1-100], webp[:1-101], ppm, bmp (default: png).", "codec[:q]");
+    QCommandLineOption benchOpt("bench-codecs", "Don't extract: encode sample frames with each format setting (or just --format) and report MB/s and bytes/frame.");
+    QCommandLineOption benchFramesOpt("bench-frames", "Frames sampled for --bench-codecs (default: 60).", "n");
+    QCommandLineOption sceneOpt("scene-threshold", "Also take a frame whenever the content changes by more than T (0..1, try 0.15); one sequential decode per video.", "T");
+    QCommandLineOption sceneGapOpt("scene-min-gap", "Frames between two scene captures (default: half a second).", "N");
+    QCommandLineOption recursiveOpt({ "r", "recursive" }, "Also look for videos in subdirectories.");
+    QCommandLineOption listOpt("list", "Don't extract: print path,width,height,fps,frames,duration_s,codec for every video (CSV).");
+    parser.addOptions({ outputOpt, everyOpt, secondsOpt, framesOpt, startOpt, threadsOpt, segmentOpt, manifestOpt, shardOpt,
+                       formatOpt, benchOpt, benchFramesOpt, sceneOpt, sceneGapOpt, recursiveOpt, listOpt });
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    const bool bench = parser.isSet(benchOpt);
+    const bool list = parser.isSet(listOpt);
+    if (args.size() != 1 || (!bench && !list && !parser.isSet(outputOpt)))
+    {
+        err << "Need exactly one input and --output.\n\n" << parser.helpText();
+        return 1;
+    }
+
+    ExtractOptions opt;
+    if (parser.isSet(formatOpt) && !ImageFormat::parse(parser.value(formatOpt), opt.format))
+    {
+        err << "Bad --format: " << parser.value(formatOpt) << "\n";
+        return 1;
+    }
+    if (parser.isSet(threadsOpt)) opt.threads = parser.value(threadsOpt).toInt();
+
+    const QString input = args.first();
+    QStringList videos;
+    VideoCatalog catalog;
+    if (QFileInfo(input).isDir())
+    {
+        // Cached probe results: only new or changed files get opened, in parallel
+        catalog.load(input, parser.isSet(recursiveOpt));
+        const int probed = catalog.refresh(opt.threads > 0 ? 2 * opt.threads : 0, nullptr, [&err](int done, int total) {
+            err << "\rProbing: " << done << " / " << total << "   ";
+            err.flush();
+        });
+        if (probed > 0) err << "\n";
+
+        videos = catalog.readablePaths();
+        const int unreadable = catalog.size() - videos.size();
+        if (unreadable > 0) err << "Skipping " << unreadable << " unreadable video(s)\n";
+    }
+    else if (QFileInfo::exists(input))
+        videos << input;
+
+    if (videos.isEmpty())
+    {
+        err << "No videos found at " << input << "\n";
+        return 1;
+    }
+
+    if (list)
+    {
+        std::vector<VideoInfo> infos;
+        for (const QString &path : videos)
+        {
+            VideoInfo info;
+            infos.push_back(catalog.find(path, info) ? info : VideoCatalog::probe(path));
+        }
+        out << "path,width,height,fps,frames,duration_s,codec\n";
+        for (const VideoInfo &v : infos)
+        {
+            QString path = v.path;
+            if (path.contains(',') || path.contains('"'))
+                path = QString("\"%1\"").arg(path.replace('"', "\"\""));
+            out << path << "," << v.width << "," << v.height << "," << QString::number(v.fps, 'f', 3) << ","
+                << v.frameCount << "," << QString::number(v.durationSec(), 'f', 2) << "," << v.codec << "\n";
+        }
+        return 0;
+    }
+
+    if (bench)
+    {
+        const int count = parser.isSet(benchFramesOpt) ? std::max(1, parser.value(benchFramesOpt).toInt()) : 60;
+        const std::vector<cv::Mat> frames = CodecBench::sampleFrames(videos, count);
+        if (frames.empty())
+        {
+            err << "Could not decode any frames from " << input << "\n";
+            return 1;
+        }
+
+        const QList<ImageFormat> formats = parser.isSet(formatOpt) ? QList<ImageFormat>{ opt.format }
+                                                                   : ImageFormat::benchmarkSet();
+        out << QString("%1 frames, %2x%3\n").arg(frames.size()).arg(frames[0].cols).arg(frames[0].rows);
+        out << QString("%1 %2 %3 %4\n").arg("format", -10).arg("MB/s", 10).arg("KB/frame", 10).arg("ratio", 8);
+        for (const ImageFormat &f : formats)
+        {
+            const CodecBenchResult r = CodecBench::run(frames, f, opt.threads);
+            if (!r.ok)
+            {
+                out << QString("%1 %2\n").arg(f.toString(), -10).arg("not available in this OpenCV build");
+                continue;
+            }
+            out << QString("%1 %2 %3 %4\n")
+                       .arg(f.toString(), -10)
+                       .arg(r.mbPerSec(), 10, 'f', 1)
+                       .arg(r.bytesPerFrame() / 1024.0, 10, 'f', 1)
+                       .arg(double(r.rawBytes) / std::max<qint64>(1, r.encodedBytes), 8, 'f', 2);
+            out.flush();
+        }
+        return 0;
+    }
+
+    opt.outputDir = parser.value(outputOpt);
+    opt.rule.everyNth = parser.value(everyOpt).toInt();
+    opt.rule.everySeconds = parser.value(secondsOpt).toDouble();
+    if (parser.isSet(framesOpt) && !SamplingRule::parseFrameList(parser.value(framesOpt), opt.rule.frames))
+    {
+        err << "Bad --frames list: " << parser.value(framesOpt) << "\n";
+        return 1;
+    }
+    opt.sceneThreshold = parser.value(sceneOpt).toDouble();
+    opt.sceneMinGap = parser.value(sceneGapOpt).toInt();
+    if (opt.rule.isEmpty() && opt.sceneThreshold <= 0.0)
+    {
+        err << "No sampling rule: use --every, --every-seconds, --frames and/or --scene-threshold.\n";
+        return 1;
+    }
+    if (parser.isSet(startOpt)) opt.firstImageIndex = parser.value(startOpt).toInt();
+    if (parser.isSet(segmentOpt)) opt.segmentsPerVideo = std::max(1, parser.value(segmentOpt).toInt());
+    if (parser.isSet(manifestOpt)) opt.manifestPath = parser.value(manifestOpt);
+    if (parser.isSet(shardOpt)) opt.shardBytes = std::max(1, parser.value(shardOpt).toInt()) * qint64(1024 * 1024);
+
+    FrameExtractor extractor(opt);
+    extractor.setCatalog(&catalog);
+    extractor.onProgress = [&err](int done, int total) {
+        err << "\rImages: " << done;
+        if (total > 0) err << " / " << total;   // unknown up front in scene mode
+        err << "   ";
+        err.flush();
+    };
+
+    QElapsedTimer t;
+    t.start();
+    const ExtractStats stats = extractor.extractAll(videos);
+    const double secs = std::max(0.001, t.elapsed() / 1000.0);
+
+    err << "\n";
+    out << "Videos: " << stats.videos << " / " << videos.size() << "\n"
+        << "Frames decoded: " << stats.framesDecoded << ", skipped: " << stats.framesSkipped << "\n"
+        << "Images written: " << stats.imagesWritten << ", failed: " << stats.imagesFailed
+        << ", missing: " << stats.imagesMissing << "\n"
+        << "Next image: " << stats.nextImageIndex << "\n"
+        << QString("Time: %1 s (%2 images/s)\n").arg(secs, 0, 'f', 1).arg(stats.imagesWritten / secs, 0, 'f', 1);
+    const FramePool::Stats pool = FramePool::shared().stats();
+    out << QString("Frame buffers: %1 allocated for %2 frames, %3 MB pooled\n")
+               .arg(pool.allocated).arg(pool.acquired).arg(pool.bytes / (1024.0 * 1024.0), 0, 'f', 0);
+
+    return (stats.imagesFailed > 0 || stats.videos < videos.size()) ? 2 : 0;
+}
@@ -0,0 +1,94 @@
+#include "framecache.h"
+
+#include <algorithm>
+
+void FrameCache::setBudgetBytes(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = bytes;
+    evictLocked();
+}
+
+size_t FrameCache::budgetBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_;
+}
+
+size_t FrameCache::bytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+void FrameCache::insert(int index, const cv::Mat &bgr)
+{
+    if (bgr.empty()) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (budget_ == 0) return;
+
+    auto it = frames_.find(index);
+    if (it != frames_.end())
+    {
+        // Same frame decoded again (ring + filler overlap): just refresh it
+        bytes_ -= sizeOf(it->second.bgr);
+        it->second.bgr = bgr;
+        bytes_ += sizeOf(bgr);
+        lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+    }
+    else
+    {
+        lru_.push_front(index);
+        frames_.emplace(index, Entry{ bgr, lru_.begin() });
+        bytes_ += sizeOf(bgr);
+    }
+    evictLocked();
+}
+
+bool FrameCache::find(int index, cv::Mat &out)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = frames_.find(index);
+    if (it == frames_.end()) return false;
+
+    lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+    out = it->second.bgr;
+    return true;
+}
+
+bool FrameCache::contains(int index) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frames_.count(index) != 0;
+}
+
+void FrameCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    frames_.clear();
+    lru_.clear();
+    bytes_ = 0;
+}
+
+int FrameCache::capacityFor(const cv::Mat &sample) const
+{
+    const size_t frameBytes = std::max<size_t>(1, sizeOf(sample));
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(budget_ / frameBytes);
+}
+
+void FrameCache::evictLocked()
+{
+    while (bytes_ > budget_ && !lru_.empty())
+    {
+        const int victim = lru_.back();
+        lru_.pop_back();
+        auto it = frames_.find(victim);
+        if (it != frames_.end())
+        {
+            bytes_ -= sizeOf(it->second.bgr);
+            frames_.erase(it);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include <opencv2/opencv.hpp>
+
+// Decoded frames by frame number, least recently used evicted first once the
+// memory budget is exceeded. Thread-safe: the decoder threads insert, the GUI
+// looks up. Frames are shared (refcounted cv::Mat), never copied.
+class FrameCache
+{
+public:
+    void setBudgetBytes(size_t bytes);
+    size_t budgetBytes() const;
+    size_t bytes() const;
+
+    void insert(int index, const cv::Mat &bgr);
+    bool find(int index, cv::Mat &out);   // marks the frame as recently used
+    bool contains(int index) const;
+    void clear();
+
+    // How many frames of this size fit in the budget
+    int capacityFor(const cv::Mat &sample) const;
+
+private:
+    struct Entry
+    {
+        cv::Mat bgr;
+        std::list<int>::iterator lruPos;
+    };
+
+    static size_t sizeOf(const cv::Mat &m) { return m.total() * m.elemSize(); }
+    void evictLocked();
+
+    mutable std::mutex mutex_;
+    std::unordered_map<int, Entry> frames_;
+    std::list<int> lru_;            // front = most recently used
+    size_t bytes_ = 0;
+    size_t budget_ = size_t(512) * 1024 * 1024;
+};
+
+#endif // FRAMECACHE_H
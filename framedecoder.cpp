@@ -0,0 +1,508 @@
+#include "framedecoder.h"
+
+#include "framemetrics.h"
+#include "framepool.h"
+
+FrameDecoder::FrameDecoder(QObject *parent)
+    : QObject(parent)
+{
+}
+
+FrameDecoder::~FrameDecoder()
+{
+    close();
+}
+
+bool FrameDecoder::open(const QString &path)
+{
+    close();
+
+    cap_.open(path.toStdString());
+    if (!cap_.isOpened())
+        return false;
+
+    fps_ = cap_.get(cv::CAP_PROP_FPS);
+    if (fps_ <= 0.0) fps_ = 30.0;
+    frameCount_ = static_cast<int>(cap_.get(cv::CAP_PROP_FRAME_COUNT));
+
+    opened_ = true;
+    decodePos_ = 0;
+    geometry_ = cv::Size();
+    cache_.clear();
+    {
+        std::lock_guard<std::mutex> lock(metricsMutex_);
+        sharpness_.assign(static_cast<size_t>(std::max(0, frameCount_.load())), -1.0f);
+    }
+    ++metricsVersion_;
+    startWorker();
+
+    {
+        std::lock_guard<std::mutex> lock(fillMutex_);
+        fillStop_ = false;
+        fillCenter_ = -1;
+    }
+    filler_ = std::thread(&FrameDecoder::runFiller, this, path);
+
+    // Keyframe index: cached per file, otherwise one background pass over the packets
+    // (never a full decode: without packet reading build() gives up right away)
+    indexCancel_ = false;
+    indexer_ = std::thread([this, path]() {
+        auto idx = std::make_shared<const KeyframeIndex>(KeyframeIndex::loadOrBuild(path, &indexCancel_));
+        if (!idx->isValid() || indexCancel_) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            index_ = idx;
+        }
+        // CAP_PROP_FRAME_COUNT is only an estimate for many containers
+        frameCount_ = idx->frameCount();
+        {
+            // The filler waits for the index, give it another go
+            std::lock_guard<std::mutex> lock(fillMutex_);
+            fillGeneration_++;
+        }
+        fillCond_.notify_all();
+        emit indexReady();
+    });
+    return true;
+}
+
+void FrameDecoder::close()
+{
+    indexCancel_ = true;
+    if (indexer_.joinable()) indexer_.join();
+    {
+        std::lock_guard<std::mutex> lock(fillMutex_);
+        fillStop_ = true;
+        fillGeneration_++;
+    }
+    fillCond_.notify_all();
+    if (filler_.joinable()) filler_.join();
+    stopWorker();
+    cache_.clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        index_.reset();
+    }
+    if (cap_.isOpened()) cap_.release();
+    {
+        std::lock_guard<std::mutex> lock(metricsMutex_);
+        sharpness_.clear();
+    }
+    ++metricsVersion_;
+    opened_ = false;
+    frameCount_ = 0;
+}
+
+std::shared_ptr<const KeyframeIndex> FrameDecoder::keyframeIndex() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_;
+}
+
+void FrameDecoder::setCapacity(int frames)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = std::max(1, frames);
+    }
+    cond_.notify_all();
+}
+
+int FrameDecoder::capacity() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+}
+
+void FrameDecoder::seek(int frameIndex)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pendingSeek_ = std::max(0, frameIndex);
+        pendingCoarse_ = false;
+        ring_.clear();
+        ++generation_;
+        skipBefore_ = -1;
+    }
+    cond_.notify_all();
+}
+
+void FrameDecoder::scrubTo(int frameIndex)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pendingSeek_ = std::max(0, frameIndex);
+        pendingCoarse_ = true;
+        ring_.clear();
+        ++generation_;
+        skipBefore_ = -1;
+    }
+    cond_.notify_all();
+}
+
+bool FrameDecoder::takeFrame(DecodedFrame &out)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ring_.empty() || pendingSeek_ >= 0) return false;
+        out = std::move(ring_.front());
+        ring_.pop_front();
+    }
+    cond_.notify_all();   // room for one more
+    return true;
+}
+
+bool FrameDecoder::peekFrontPts(double &ptsMs) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ring_.empty() || pendingSeek_ >= 0) return false;
+    ptsMs = ring_.front().ptsMs;
+    return true;
+}
+
+bool FrameDecoder::takeFrameAt(int frameIndex, DecodedFrame &out)
+{
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pendingSeek_ >= 0) return false;
+        // Only worth it if the target is somewhere inside the ring
+        if (ring_.empty() || frameIndex < ring_.front().index || frameIndex > ring_.back().index)
+            return false;
+
+        while (!ring_.empty() && ring_.front().index < frameIndex)
+            ring_.pop_front();
+        if (!ring_.empty() && ring_.front().index == frameIndex)
+        {
+            out = std::move(ring_.front());
+            ring_.pop_front();
+            found = true;
+        }
+    }
+    cond_.notify_all();
+    return found;
+}
+
+void FrameDecoder::continueFrom(int frameIndex)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pendingSeek_ >= 0) return;   // a seek is already on its way
+        while (!ring_.empty() && ring_.front().index < frameIndex)
+            ring_.pop_front();
+        if (!ring_.empty() && ring_.front().index == frameIndex) return;
+    }
+    seek(frameIndex);
+}
+
+void FrameDecoder::setIdleCenter(int frameIndex)
+{
+    {
+        std::lock_guard<std::mutex> lock(fillMutex_);
+        if (fillCenter_ == frameIndex) return;
+        fillCenter_ = frameIndex;
+        fillGeneration_++;
+    }
+    fillCond_.notify_all();
+}
+
+bool FrameDecoder::atEnd() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return eof_ && ring_.empty() && pendingSeek_ < 0;
+}
+
+// ================== Worker ==================
+
+void FrameDecoder::startWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ring_.clear();
+        pendingSeek_ = -1;
+        eof_ = false;
+        stop_ = false;
+        ++generation_;
+    }
+    notifyPending_ = false;
+    worker_ = std::thread(&FrameDecoder::run, this);
+}
+
+void FrameDecoder::stopWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    if (worker_.joinable()) worker_.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ring_.clear();
+}
+
+void FrameDecoder::notify()
+{
+    // Coalesce: one pending notification is enough for the GUI to drain the ring
+    if (!notifyPending_.exchange(true))
+        emit frameAvailable();
+}
+
+bool FrameDecoder::seekCapture(int target, quint64 gen)
+{
+    std::shared_ptr<const KeyframeIndex> index = keyframeIndex();
+    if (!index || !index->hasKeyframes())
+    {
+        // No index (yet): let the backend seek and report where it landed
+        cap_.set(cv::CAP_PROP_POS_FRAMES, target);
+        decodePos_ = -1;
+        return true;
+    }
+
+    // Jump to the keyframe before the target, unless we are already inside
+    // that GOP and before the target: then just decoding forward is cheaper
+    const int key = index->keyframeAtOrBefore(target);
+    if (decodePos_ < key || decodePos_ > target)
+    {
+        cap_.set(cv::CAP_PROP_POS_FRAMES, key);
+        decodePos_ = key;
+    }
+    while (decodePos_ < target)
+    {
+        // User already moved on (scrubbing) => don't finish decoding this GOP
+        if (gen != generation_) return false;
+        if (!cap_.grab()) break;
+        ++decodePos_;
+    }
+    return true;
+}
+
+void FrameDecoder::run()
+{
+    quint64 detectGen = 0;   // scene detector reference belongs to this seek generation
+    bool readSinceSeek = false;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        cond_.wait(lock, [this]() {
+            return stop_ || pendingSeek_ >= 0
+                   || (!eof_ && static_cast<int>(ring_.size()) < capacity_);
+        });
+        if (stop_) break;
+
+        const bool seeking = pendingSeek_ >= 0;
+        int target = pendingSeek_;
+        const bool coarse = pendingCoarse_;
+        pendingSeek_ = -1;
+        pendingCoarse_ = false;
+        const quint64 gen = generation_;
+        eof_ = false;
+        lock.unlock();
+
+        if (seeking && coarse)
+        {
+            // Scrubbing: the keyframe decodes on its own, no GOP walk
+            std::shared_ptr<const KeyframeIndex> index = keyframeIndex();
+            if (index && index->hasKeyframes())
+                target = index->keyframeAtOrBefore(target);
+        }
+
+        if (seeking && !seekCapture(target, gen))
+        {
+            lock.lock();
+            continue;   // superseded by a newer seek
+        }
+
+        if (seeking)
+        {
+            readSinceSeek = false;   // the seek target itself is always read
+        }
+        else
+        {
+            // Behind the playback clock: advance without retrieve() (no colour conversion / copy)
+            int skipped = 0;
+            while (decodePos_ >= 0 && decodePos_ < skipBefore_ && gen == generation_ && cap_.grab())
+            {
+                ++decodePos_;
+                ++skipped;
+            }
+            skipped_ += skipped;
+
+            // Fast playback: same thing for the frames between two shown ones
+            for (int i = stride_ - 1; readSinceSeek && skipped == 0 && i > 0 && gen == generation_; --i)
+            {
+                if (!cap_.grab()) break;
+                if (decodePos_ >= 0) ++decodePos_;
+            }
+        }
+
+        DecodedFrame f;
+        const bool ok = FramePool::shared().read(cap_, f.bgr, geometry_);
+        if (ok)
+        {
+            readSinceSeek = true;
+            // Count ourselves when we know where we are; otherwise the container decides
+            if (decodePos_ >= 0)
+                f.index = decodePos_++;
+            else
+                f.index = static_cast<int>(cap_.get(cv::CAP_PROP_POS_FRAMES)) - 1;
+            f.ptsMs = cap_.get(cv::CAP_PROP_POS_MSEC);
+            if (f.ptsMs <= 0.0 && f.index > 0)
+                f.ptsMs = f.index * 1000.0 / fps_;   // backend has no timestamps
+            const cv::Mat luma = FrameMetrics::luma(f.bgr);
+            f.sharpness = measure(f.index, luma);
+
+            const double threshold = sceneThreshold_;
+            if (threshold > 0.0)
+            {
+                // After a seek the first frame is the new reference, not a scene change
+                if (gen != detectGen) scene_.reset();
+                detectGen = gen;
+                scene_.setThreshold(threshold);
+                scene_.setMinGap(std::max(1, static_cast<int>(fps_ / 2)));
+                f.sceneChange = scene_.feed(f.index, luma);
+            }
+        }
+
+        lock.lock();
+        if (gen != generation_) continue;   // a newer seek arrived meanwhile, drop this one
+
+        if (!ok)
+        {
+            eof_ = true;
+            lock.unlock();
+            notify();
+            lock.lock();
+            continue;
+        }
+
+        cache_.insert(f.index, f.bgr);
+        const bool wasEmpty = ring_.empty();
+        ring_.push_back(std::move(f));
+        if (wasEmpty || seeking)
+        {
+            lock.unlock();
+            notify();
+            lock.lock();
+        }
+    }
+}
+
+// ================== Idle cache filler ==================
+
+void FrameDecoder::runFiller(const QString &path)
+{
+    cv::VideoCapture cap;   // opened lazily, first time we are paused
+    int pos = -1;
+    quint64 doneGen = 0;
+
+    std::unique_lock<std::mutex> lock(fillMutex_);
+    while (true)
+    {
+        fillCond_.wait(lock, [this, &doneGen]() {
+            return fillStop_ || (fillCenter_ >= 0 && fillGeneration_ != doneGen);
+        });
+        if (fillStop_) break;
+
+        const int center = fillCenter_;
+        const quint64 gen = fillGeneration_;
+        lock.unlock();
+
+        fillWindow(cap, pos, path, center, gen);
+
+        lock.lock();
+        doneGen = gen;   // if the center moved meanwhile the wait falls through again
+    }
+}
+
+void FrameDecoder::fillWindow(cv::VideoCapture &cap, int &pos, const QString &path, int center, quint64 gen)
+{
+    // Without keyframes we can't tell which frame a seek lands on, so don't guess
+    std::shared_ptr<const KeyframeIndex> index = keyframeIndex();
+    if (!index || !index->hasKeyframes()) return;
+
+    if (!cap.isOpened())
+    {
+        cap.open(path.toStdString());
+        if (!cap.isOpened()) return;
+        pos = 0;
+    }
+
+    // Window per side: half of what the memory budget holds (capped, no point decoding minutes)
+    const double w = cap.get(cv::CAP_PROP_FRAME_WIDTH);
+    const double h = cap.get(cv::CAP_PROP_FRAME_HEIGHT);
+    const size_t frameBytes = std::max<size_t>(1, static_cast<size_t>(w * h * 3));
+    const int perSide = std::min<int>(300, static_cast<int>(cache_.budgetBytes() / frameBytes / 2) - 1);
+    if (perSide <= 0) return;
+
+    const int lo = std::max(0, center - perSide);
+    const int hi = std::min(frameCount_ - 1, center + perSide);
+    auto stale = [this, gen]() { return fillGeneration_ != gen; };
+
+    int first = lo;
+    while (first <= hi && cache_.contains(first)) ++first;
+    if (first > hi) return;   // window complete
+
+    const int key = index->keyframeAtOrBefore(first);
+    if (pos < key || pos > first)
+    {
+        cap.set(cv::CAP_PROP_POS_FRAMES, key);
+        pos = key;
+    }
+    while (pos < first && cap.grab())
+    {
+        ++pos;
+        if (stale()) return;
+    }
+
+    cv::Mat frame;
+    cv::Size geometry;
+    while (pos <= hi && !stale())
+    {
+        if (cache_.contains(pos))
+        {
+            // Still has to be decoded to keep the GOP going, but skip the conversion
+            if (!cap.grab()) break;
+        }
+        else
+        {
+            // The cache keeps the old buffer, decode into a recycled one
+            if (!FramePool::shared().read(cap, frame, geometry)) break;
+            measure(pos, FrameMetrics::luma(frame));
+            cache_.insert(pos, frame);
+        }
+        ++pos;
+    }
+}
+
+// ================== Metrics ==================
+
+float FrameDecoder::measure(int frameIndex, const cv::Mat &luma)
+{
+    if (frameIndex < 0) return -1.0f;
+
+    // Outside any lock: ~0.3 ms for 1080p, most of it making the luma thumbnail
+    const float value = FrameMetrics::sharpness(luma);
+    {
+        std::lock_guard<std::mutex> lock(metricsMutex_);
+        if (frameIndex >= static_cast<int>(sharpness_.size()))
+            sharpness_.resize(static_cast<size_t>(frameIndex) + 1, -1.0f);   // frame count was an estimate
+        sharpness_[static_cast<size_t>(frameIndex)] = value;
+    }
+    ++metricsVersion_;
+    return value;
+}
+
+float FrameDecoder::sharpnessAt(int frameIndex) const
+{
+    std::lock_guard<std::mutex> lock(metricsMutex_);
+    if (frameIndex < 0 || frameIndex >= static_cast<int>(sharpness_.size())) return -1.0f;
+    return sharpness_[static_cast<size_t>(frameIndex)];
+}
+
+std::vector<float> FrameDecoder::sharpnessCurve() const
+{
+    std::lock_guard<std::mutex> lock(metricsMutex_);
+    return sharpness_;
+}
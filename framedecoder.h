@@ -0,0 +1,176 @@
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+
+#include <QObject>
+#include <QString>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "framecache.h"
+#include "keyframeindex.h"
+#include "scenedetector.h"
+
+// One decoded frame as handed out by the decoder thread
+struct DecodedFrame
+{
+    int index = -1;        // frame number in the video
+    double ptsMs = 0.0;    // presentation time (CAP_PROP_POS_MSEC)
+    cv::Mat bgr;
+    float sharpness = -1.0f;   // FrameMetrics::sharpness(), -1 = not measured
+    bool sceneChange = false;  // SceneDetector fired (only while scene detection is on)
+};
+
+// Owns the cv::VideoCapture and decodes on its own thread into a small
+// bounded ring of frames ahead of the play head. The GUI only ever takes
+// finished frames out of the ring, so a slow decode never blocks it.
+// Every decoded frame also lands in a FrameCache; while paused a second
+// "filler" thread with its own capture decodes the window around the play
+// head into that cache so stepping back and forth is instant.
+class FrameDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FrameDecoder(QObject *parent = nullptr);
+    ~FrameDecoder() override;
+
+    // Probe the file and start prefetching from frame 0.
+    // The keyframe index is loaded/built in the background (see indexReady()).
+    bool open(const QString &path);
+    void close();
+
+    bool isOpened() const { return opened_; }
+    double fps() const { return fps_; }
+    int frameCount() const { return frameCount_; }
+
+    // Null until the background indexer finished
+    std::shared_ptr<const KeyframeIndex> keyframeIndex() const;
+
+    // How many decoded frames may wait in the ring (each 4K BGR frame is ~25 MB)
+    void setCapacity(int frames);
+    int capacity() const;
+
+    // Drop everything buffered and restart decoding at frameIndex.
+    // Latest wins: a newer seek cancels one still in progress.
+    void seek(int frameIndex);
+
+    // Cheap seek for slider drags: only decode the keyframe at or before
+    // frameIndex (falls back to seek() without a keyframe index)
+    void scrubTo(int frameIndex);
+
+    // Pop the next frame in decode order (non-blocking)
+    bool takeFrame(DecodedFrame &out);
+
+    // Presentation time of the next frame takeFrame() would return
+    bool peekFrontPts(double &ptsMs) const;
+
+    // Playback fell behind: frames before frameIndex are only grab()bed,
+    // never retrieved/colour converted. -1 = decode everything.
+    void setSkipBefore(int frameIndex) { skipBefore_ = frameIndex; }
+    int skippedFrames() const { return skipped_; }
+
+    // Fast playback: only every stride-th frame is read, the ones between
+    // are grab()bed (decoded, never converted or copied). 1 = every frame.
+    void setStride(int frames) { stride_ = std::max(1, frames); }
+    int stride() const { return stride_; }
+    void resetStats() { skipped_ = 0; }
+
+    // Pop frameIndex if it is already buffered, discarding older frames
+    bool takeFrameAt(int frameIndex, DecodedFrame &out);
+
+    // Make sure the ring continues at frameIndex (seeks only if it doesn't)
+    void continueFrom(int frameIndex);
+
+    // True once the decoder hit the end and every buffered frame was taken
+    bool atEnd() const;
+
+    // Decoded frames around the play head (filled by both threads)
+    FrameCache &cache() { return cache_; }
+
+    // Paused at frameIndex => fill the cache around it; -1 = playing, stop filling
+    void setIdleCenter(int frameIndex);
+
+    // Sharpness of every frame either thread decoded so far (-1 = unknown).
+    // Measured right after decode, on the decoder threads.
+    float sharpnessAt(int frameIndex) const;
+    std::vector<float> sharpnessCurve() const;
+    quint64 metricsVersion() const { return metricsVersion_; }   // bumped on every new value
+
+    // Mark frames where the content changed (see SceneDetector); <= 0 = off.
+    // Runs on the playback decoder only, in decode order.
+    void setSceneThreshold(double t) { sceneThreshold_ = t; }
+
+    // Call after handling frameAvailable() so the next one gets emitted
+    void acknowledge() { notifyPending_ = false; }
+
+signals:
+    // A frame landed in an empty ring or a seek finished (emitted from the decoder thread)
+    void frameAvailable();
+    // Keyframe index is in place; frameCount() may have been corrected
+    void indexReady();
+
+private:
+    void run();
+    void startWorker();
+    void stopWorker();
+    void notify();
+    bool seekCapture(int target, quint64 gen);
+    float measure(int frameIndex, const cv::Mat &luma);
+    void runFiller(const QString &path);
+    void fillWindow(cv::VideoCapture &cap, int &pos, const QString &path, int center, quint64 gen);
+
+    cv::VideoCapture cap_;        // only touched by the worker while it runs
+    int decodePos_ = -1;          // frame the next read() returns, -1 = ask the container
+    cv::Size geometry_;           // frame size for FramePool, 0x0 = ask the capture
+    std::thread worker_;
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+
+    std::deque<DecodedFrame> ring_;
+    int capacity_ = 6;
+    int pendingSeek_ = -1;        // latest requested seek, -1 = none
+    bool pendingCoarse_ = false;  // pendingSeek_ came from scrubTo()
+    std::atomic<quint64> generation_{0};   // bumped on every seek, stale work gets dropped
+    bool eof_ = false;
+    bool stop_ = false;
+    std::atomic<bool> notifyPending_{false};
+    std::atomic<int> skipBefore_{-1};
+    std::atomic<int> skipped_{0};
+    std::atomic<int> stride_{1};
+
+    // Keyframe index (built on indexer_, read by the worker when seeking)
+    std::thread indexer_;
+    std::atomic<bool> indexCancel_{false};
+    std::shared_ptr<const KeyframeIndex> index_;
+
+    // Idle cache filler
+    FrameCache cache_;
+    std::thread filler_;
+    std::mutex fillMutex_;
+    std::condition_variable fillCond_;
+    int fillCenter_ = -1;
+    std::atomic<quint64> fillGeneration_{0};   // bumped whenever the center moves
+    bool fillStop_ = false;
+
+    // Per-frame metrics
+    mutable std::mutex metricsMutex_;
+    std::vector<float> sharpness_;
+    std::atomic<quint64> metricsVersion_{0};
+    std::atomic<double> sceneThreshold_{0.0};
+    SceneDetector scene_;                      // worker thread only
+
+    bool opened_ = false;
+    double fps_ = 30.0;
+    std::atomic<int> frameCount_{0};
+};
+
+#endif // FRAMEDECODER_H
@@ -0,0 +1,535 @@
+#include "frameextractor.h"
+
+#include "datasetdir.h"
+#include "framemetrics.h"
+#include "framepool.h"
+#include "keyframeindex.h"
+#include "scenedetector.h"
+#include "shardwriter.h"
+#include "videocatalog.h"
+#include "workstealingpool.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTextStream>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <thread>
+
+#include <opencv2/opencv.hpp>
+
+// ================== SamplingRule ==================
+
+bool SamplingRule::selects(int frame, double fps) const
+{
+    if (everyNth > 0 && frame % everyNth == 0)
+        return true;
+
+    if (everySeconds > 0.0)
+    {
+        // First frame at or after every multiple of the period
+        const double period = everySeconds * fps;   // in frames
+        if (frame == 0) return true;
+        if (std::floor(frame / period + 1e-9) != std::floor((frame - 1) / period + 1e-9))
+            return true;
+    }
+
+    return std::binary_search(frames.begin(), frames.end(), frame);
+}
+
+bool SamplingRule::parseFrameList(const QString &text, std::vector<int> &out)
+{
+    out.clear();
+    const QStringList parts = text.split(',', Qt::SkipEmptyParts);
+    for (const QString &raw : parts)
+    {
+        const QString part = raw.trimmed();
+        const int dash = part.indexOf('-', 1);
+        bool ok1 = false, ok2 = true;
+        int a = 0, b = 0;
+        if (dash > 0)
+        {
+            a = part.left(dash).toInt(&ok1);
+            b = part.mid(dash + 1).toInt(&ok2);
+        }
+        else
+        {
+            a = b = part.toInt(&ok1);
+        }
+        if (!ok1 || !ok2 || a < 0 || b < a) return false;
+        for (int i = a; i <= b; ++i)
+            out.push_back(i);
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return true;
+}
+
+// ================== FrameExtractor ==================
+
+FrameExtractor::FrameExtractor(const ExtractOptions &options)
+    : opt_(options)
+    , reserver_(64)
+{
+    reserver_.setDirectory(opt_.outputDir);
+    params_ = opt_.format.params();
+    nextIndex_ = opt_.firstImageIndex > 0 ? opt_.firstImageIndex
+                                          : DatasetDir::extractLargestNumberInDir(opt_.outputDir) + 1;
+}
+
+FrameExtractor::~FrameExtractor() = default;
+
+FrameExtractor::VideoPlan FrameExtractor::planVideo(const QString &videoPath) const
+{
+    VideoPlan plan;
+    VideoInfo info;
+    if (!catalog_ || !catalog_->find(videoPath, info))
+        info = VideoCatalog::probe(videoPath);
+    if (!info.ok) return plan;
+
+    plan.ok = true;
+    plan.fps = info.fps > 0.0 ? info.fps : 30.0;
+    plan.frameCount = info.frameCount;
+
+    // Keyframes tell us where a long video can be cut (and give the real frame count).
+    // Short clips aren't split, so only use an index the GUI already cached. Without
+    // packet reading an index means decoding the whole file first: cut unsnapped instead.
+    const bool longVideo = plan.frameCount > 2 * std::max(1, opt_.minSegmentFrames);
+    const KeyframeIndex index = longVideo && KeyframeIndex::canReadKeyframes() ? KeyframeIndex::loadOrBuild(videoPath)
+                                                                               : KeyframeIndex::load(videoPath);
+    if (index.isValid())
+    {
+        plan.frameCount = index.frameCount();
+        if (index.hasKeyframes())
+            plan.keyframes = std::make_shared<const std::vector<int>>(index.keyframes());
+    }
+
+    const SamplingRule &rule = opt_.rule;
+    if (rule.everyNth <= 0 && rule.everySeconds <= 0.0)
+    {
+        for (int f : rule.frames)
+            if (f < plan.frameCount) plan.selected.push_back(f);
+    }
+    else
+    {
+        for (int f = 0; f < plan.frameCount; ++f)
+            if (rule.selects(f, plan.fps)) plan.selected.push_back(f);
+    }
+    return plan;
+}
+
+ExtractStats FrameExtractor::extractAll(const QStringList &videos)
+{
+    ExtractStats stats;
+    QDir().mkpath(opt_.outputDir);
+
+    WorkStealingPool pool(opt_.threads);
+    inFlightLimit_ = opt_.framesInFlight > 0 ? opt_.framesInFlight : pool.threadCount() * 4;
+
+    // 1. Probe every video in parallel (opening thousands of files is mostly waiting)
+    std::vector<VideoPlan> plans(videos.size());
+    for (int i = 0; i < videos.size(); ++i)
+        pool.submit([this, &plans, &videos, i]() { plans[i] = planVideo(videos[i]); });
+    pool.waitIdle();
+
+    // Scene changes are only known while decoding: separate path
+    if (opt_.sceneThreshold > 0.0)
+        return extractScenes(pool, videos, plans);
+
+    // 2. Number every selected frame up front, cut long videos into segments.
+    //    Auto mode aims for ~4 segments per thread overall, spread by video length.
+    double totalFrames = 0.0;
+    for (const VideoPlan &plan : plans)
+        if (plan.ok) totalFrames += plan.frameCount;
+    const int targetSegments = pool.threadCount() * 4;
+
+    // One contiguous block from the folder's shared counter: other instances
+    // (GUI or headless) writing into the same folder get different numbers
+    int selectedTotal = 0;
+    for (const VideoPlan &plan : plans)
+        if (plan.ok) selectedTotal += static_cast<int>(plan.selected.size());
+    if (selectedTotal > 0)
+    {
+        const int first = reserver_.reserveBlock(selectedTotal, nextIndex_);
+        if (first < 0)
+        {
+            stats.imagesMissing = selectedTotal;
+            stats.nextImageIndex = nextIndex_;
+            return stats;
+        }
+        nextIndex_ = first;
+    }
+
+    std::vector<Segment> segments;
+    int next = nextIndex_;
+    for (int i = 0; i < videos.size(); ++i)
+    {
+        const VideoPlan &plan = plans[i];
+        if (!plan.ok) continue;
+        ++stats.videos;
+
+        int pieces = opt_.segmentsPerVideo;
+        if (pieces <= 0)
+            pieces = static_cast<int>(std::lround(targetSegments * double(plan.frameCount) / std::max(1.0, totalFrames)));
+        pieces = std::clamp(pieces, 1, std::max(1, plan.frameCount / std::max(1, opt_.minSegmentFrames)));
+
+        const std::vector<int> starts = segmentStarts(plan, pieces);
+        size_t k = 0;
+        for (size_t s = 0; s < starts.size() && k < plan.selected.size(); ++s)
+        {
+            const int end = (s + 1 < starts.size()) ? starts[s + 1] : INT_MAX;
+            Segment seg;
+            seg.video = videos[i];
+            seg.begin = starts[s];
+            seg.exactStart = plan.keyframes != nullptr;
+            seg.firstImage = next + static_cast<int>(k);
+            seg.keyframes = plan.keyframes;
+            while (k < plan.selected.size() && plan.selected[k] < end)
+                seg.frames.push_back(plan.selected[k++]);
+            if (!seg.frames.empty())
+                segments.push_back(std::move(seg));
+        }
+        next += static_cast<int>(plan.selected.size());
+    }
+    planned_ = next - nextIndex_;
+    writtenAs_ = std::vector<std::atomic<int>>(static_cast<size_t>(planned_));
+
+    // 3. Decode tasks; each one feeds encode tasks into the same pool
+    if (opt_.shardBytes > 0)
+        shards_ = std::make_unique<ShardWriter>(opt_.outputDir, opt_.shardBytes);
+    for (const Segment &seg : segments)
+        pool.submit([this, &pool, &seg]() { runSegment(pool, seg); });
+    pool.waitIdle();
+    if (shards_ && !shards_->finish())
+        ++failed_;   // last shard couldn't be closed cleanly
+    shards_.reset();
+
+    if (!opt_.manifestPath.isEmpty())
+        writeManifest(videos, plans);
+
+    nextIndex_ = next;
+    stats.framesDecoded = decoded_;
+    stats.framesSkipped = skipped_;
+    stats.imagesWritten = written_;
+    stats.imagesFailed = failed_;
+    stats.imagesMissing = missing_;
+    stats.nextImageIndex = nextIndex_;
+    return stats;
+}
+
+std::vector<int> FrameExtractor::segmentStarts(const VideoPlan &plan, int pieces) const
+{
+    std::vector<int> starts{ 0 };
+    for (int s = 1; s < pieces; ++s)
+    {
+        int b = static_cast<int>(static_cast<long long>(plan.frameCount) * s / pieces);
+        if (plan.keyframes && !plan.keyframes->empty())
+        {
+            // Snap to the keyframe at or before b: decoding can start there without a GOP walk
+            auto it = std::upper_bound(plan.keyframes->begin(), plan.keyframes->end(), b);
+            b = (it == plan.keyframes->begin()) ? 0 : *(it - 1);
+        }
+        if (b > starts.back())
+            starts.push_back(b);
+    }
+    return starts;
+}
+
+bool FrameExtractor::writeManifest(const QStringList &videos, const std::vector<VideoPlan> &plans) const
+{
+    QFile f(opt_.manifestPath);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+
+    // Segments finished in any order; the manifest is merged back into frame order
+    QTextStream out(&f);
+    out << "image,video,frame\n";
+    int image = nextIndex_;
+    for (int i = 0; i < videos.size(); ++i)
+    {
+        if (!plans[i].ok) continue;
+        for (int frame : plans[i].selected)
+        {
+            const int written = writtenAs_[static_cast<size_t>(image - nextIndex_)];
+            if (written > 0)
+                out << DatasetDir::imageFileName(written, opt_.format.extension()) << ",\"" << videos[i] << "\"," << frame << "\n";
+            ++image;
+        }
+    }
+    return true;
+}
+
+void FrameExtractor::runSegment(WorkStealingPool &pool, const Segment &seg)
+{
+    cv::VideoCapture cap(seg.video.toStdString());
+    if (!cap.isOpened())
+    {
+        missing_ += static_cast<int>(seg.frames.size());
+        return;
+    }
+
+    auto keyframeBefore = [&seg](int frame) {
+        if (!seg.keyframes || seg.keyframes->empty()) return -1;
+        auto it = std::upper_bound(seg.keyframes->begin(), seg.keyframes->end(), frame);
+        return it == seg.keyframes->begin() ? 0 : *(it - 1);
+    };
+
+    // Segment starts are keyframes when we have an index, so this lands exactly
+    int pos = 0;
+    if (seg.begin > 0)
+    {
+        const int start = seg.exactStart ? seg.begin : seg.frames.front();
+        cap.set(cv::CAP_PROP_POS_FRAMES, start);
+        pos = start;
+    }
+
+    const QDir out(opt_.outputDir);
+    cv::Size geometry;
+    size_t k = 0;
+    while (k < seg.frames.size())
+    {
+        const int want = seg.frames[k];
+        if (pos < want)
+        {
+            // Jump over long gaps via the keyframe before the target
+            const int key = keyframeBefore(want);
+            if (key > pos)
+            {
+                cap.set(cv::CAP_PROP_POS_FRAMES, key);
+                pos = key;
+            }
+        }
+
+        if (pos < want)
+        {
+            // Not wanted: decode only, skip the colour conversion
+            if (!cap.grab()) break;
+            ++skipped_;
+            ++pos;
+            continue;
+        }
+
+        cv::Mat frame;   // recycled buffer, the encode task holds it until written
+        if (!FramePool::shared().read(cap, frame, geometry)) break;
+        ++decoded_;
+
+        const int image = seg.firstImage + static_cast<int>(k);
+        const QString path = out.filePath(DatasetDir::imageFileName(image, opt_.format.extension()));
+
+        // Back-pressure: encoder is behind => help it instead of decoding more
+        while (inFlight_ >= inFlightLimit_)
+            if (!pool.helpOne()) std::this_thread::yield();
+
+        ++inFlight_;
+        pool.submit([this, out, path, frame, image]() {
+            if (shards_)
+            {
+                writeToShard(path, frame, image);
+                return;
+            }
+
+            int number = image;
+            QString target = path;
+            DatasetDir::WriteResult result = DatasetDir::writeImageExclusive(target, frame, params_);
+            for (int attempt = 0; result == DatasetDir::AlreadyExists && attempt < 100; ++attempt)
+            {
+                // Taken by a writer outside the shared counter: renumber, never overwrite
+                number = reserver_.next(number + 1);
+                if (number < 0) break;
+                target = out.filePath(DatasetDir::imageFileName(number, opt_.format.extension()));
+                result = DatasetDir::writeImageExclusive(target, frame, params_);
+            }
+            const bool ok = result == DatasetDir::Written;
+            if (ok) ++written_;
+            else    ++failed_;
+            writtenAs_[static_cast<size_t>(image - nextIndex_)] = ok ? number : 0;
+            --inFlight_;
+            reportProgress();
+        }, WorkStealingPool::High);
+
+        ++k;
+        ++pos;
+    }
+
+    // Video shorter than it claimed: those numbers stay unused
+    missing_ += static_cast<int>(seg.frames.size() - k);
+}
+
+void FrameExtractor::writeToShard(const QString &path, const cv::Mat &frame, int image)
+{
+    // Encode in parallel, only the append is serialized inside ShardWriter
+    std::vector<uchar> bytes;
+    bool ok = false;
+    try {
+        ok = cv::imencode("." + QFileInfo(path).suffix().toStdString(), frame, bytes, params_);
+    } catch (const cv::Exception &) {
+        ok = false;
+    }
+    ok = ok && shards_->append(image, QFileInfo(path).fileName(), bytes);
+
+    if (ok) ++written_;
+    else    ++failed_;
+    writtenAs_[static_cast<size_t>(image - nextIndex_)] = ok ? image : 0;
+    --inFlight_;
+    reportProgress();
+}
+
+// ================== Scene-change mode ==================
+
+ExtractStats FrameExtractor::extractScenes(WorkStealingPool &pool, const QStringList &videos,
+                                           std::vector<VideoPlan> &plans)
+{
+    // One sequential decode per video (videos run in parallel, a detector can't
+    // be split). Captures are encoded into hidden temp files right away and get
+    // their image numbers in video/frame order once every pass is done, so the
+    // numbering is as deterministic as in the planned mode.
+    ExtractStats stats;
+    std::vector<std::deque<SceneCapture>> captures(static_cast<size_t>(videos.size()));
+    for (int i = 0; i < videos.size(); ++i)
+    {
+        if (!plans[i].ok) continue;
+        ++stats.videos;
+        pool.submit([this, &pool, &videos, &plans, &captures, i]() {
+            runScenePass(pool, videos[i], plans[i].fps, captures[static_cast<size_t>(i)]);
+        });
+    }
+    pool.waitIdle();
+
+    int total = 0;
+    for (const auto &list : captures)
+        for (const SceneCapture &c : list)
+            if (c.ok) ++total;
+
+    const int first = total > 0 ? reserver_.reserveBlock(total, nextIndex_) : nextIndex_;
+    if (first >= 0) nextIndex_ = first;
+    planned_ = total;
+    writtenAs_ = std::vector<std::atomic<int>>(static_cast<size_t>(total));
+    if (opt_.shardBytes > 0)
+        shards_ = std::make_unique<ShardWriter>(opt_.outputDir, opt_.shardBytes);
+
+    int image = nextIndex_;
+    for (size_t i = 0; i < captures.size(); ++i)
+    {
+        plans[i].selected.clear();
+        for (const SceneCapture &c : captures[i])
+        {
+            if (!c.ok) continue;
+            int number = image;
+            const bool ok = first >= 0 && finishSceneCapture(c.tempPath, number);
+            if (!ok)
+            {
+                QFile::remove(c.tempPath);
+                --written_;
+                ++failed_;
+            }
+            plans[i].selected.push_back(c.frame);
+            writtenAs_[static_cast<size_t>(image - nextIndex_)] = ok ? number : 0;
+            ++image;
+        }
+    }
+    if (shards_ && !shards_->finish())
+        ++failed_;
+    shards_.reset();
+
+    if (!opt_.manifestPath.isEmpty())
+        writeManifest(videos, plans);
+
+    nextIndex_ = image;
+    stats.framesDecoded = decoded_;
+    stats.imagesWritten = written_;
+    stats.imagesFailed = failed_;
+    stats.nextImageIndex = nextIndex_;
+    return stats;
+}
+
+void FrameExtractor::runScenePass(WorkStealingPool &pool, const QString &video, double fps,
+                                  std::deque<SceneCapture> &out)
+{
+    cv::VideoCapture cap(video.toStdString());
+    if (!cap.isOpened()) return;
+
+    SceneDetector detector;
+    detector.setThreshold(opt_.sceneThreshold);
+    detector.setMinGap(opt_.sceneMinGap > 0 ? opt_.sceneMinGap : std::max(1, static_cast<int>(fps / 2)));
+    detector.setTriggerOnFirst(true);   // the opening shot is new content too
+
+    const QDir dir(opt_.outputDir);
+    const QString ext = opt_.format.extension();
+    cv::Size geometry;
+    for (int pos = 0; ; ++pos)
+    {
+        cv::Mat frame;   // recycled buffer, the encode task holds it until written
+        if (!FramePool::shared().read(cap, frame, geometry)) break;
+        ++decoded_;
+
+        // Detector sees every frame; the regular rules may add more
+        const bool scene = detector.feed(pos, FrameMetrics::luma(frame));
+        if (!scene && !(!opt_.rule.isEmpty() && opt_.rule.selects(pos, fps)))
+            continue;
+
+        out.emplace_back();   // deque: the encode task keeps a stable reference
+        SceneCapture &c = out.back();
+        c.frame = pos;
+        c.tempPath = dir.filePath(DatasetDir::tempFileName("scene", ext));
+
+        while (inFlight_ >= inFlightLimit_)
+            if (!pool.helpOne()) std::this_thread::yield();
+
+        ++inFlight_;
+        pool.submit([this, &c, frame]() {
+            bool ok = false;
+            try {
+                ok = cv::imwrite(c.tempPath.toStdString(), frame, params_);
+            } catch (const cv::Exception &) {
+                ok = false;
+            }
+            c.ok = ok;
+            if (ok) ++written_;
+            else    ++failed_;
+            --inFlight_;
+            reportProgress();
+        }, WorkStealingPool::High);
+    }
+}
+
+bool FrameExtractor::finishSceneCapture(const QString &tempPath, int &number)
+{
+    const QDir out(opt_.outputDir);
+    const QString ext = opt_.format.extension();
+
+    if (shards_)
+    {
+        QFile f(tempPath);
+        if (!f.open(QIODevice::ReadOnly)) return false;
+        const QByteArray data = f.readAll();
+        f.close();
+        const std::vector<uchar> bytes(data.begin(), data.end());
+        if (!shards_->append(number, DatasetDir::imageFileName(number, ext), bytes)) return false;
+        QFile::remove(tempPath);
+        return true;
+    }
+
+    // Same no-clobber rule as every other write: renumber if the name is taken
+    for (int attempt = 0; attempt < 100; ++attempt)
+    {
+        const QString target = out.filePath(DatasetDir::imageFileName(number, ext));
+        if (QFile::rename(tempPath, target)) return true;
+        if (!QFileInfo::exists(target)) return false;
+        number = reserver_.next(number + 1);
+        if (number < 0) return false;
+    }
+    return false;
+}
+
+void FrameExtractor::reportProgress()
+{
+    if (!onProgress) return;
+    const int done = written_ + failed_;
+    if (done % 50 != 0 && done != planned_) return;
+
+    std::lock_guard<std::mutex> lock(progressMutex_);
+    onProgress(done, planned_);
+}
@@ -0,0 +1,143 @@
+#ifndef FRAMEEXTRACTOR_H
+#define FRAMEEXTRACTOR_H
+
+#include <QString>
+#include <QStringList>
+
+#include "imageformat.h"
+#include "imagenumberreserver.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class ShardWriter;
+class VideoCatalog;
+class WorkStealingPool;
+namespace cv { class Mat; }
+
+// Which frames of a video to keep. Rules combine: a frame is taken if any rule selects it.
+struct SamplingRule
+{
+    int everyNth = 0;              // 0 = off
+    double everySeconds = 0.0;     // 0 = off
+    std::vector<int> frames;       // explicit frame numbers (sorted, unique)
+
+    bool isEmpty() const { return everyNth <= 0 && everySeconds <= 0.0 && frames.empty(); }
+
+    // Stateless so every segment of a video can decide on its own
+    bool selects(int frame, double fps) const;
+
+    // "12,40,100-120" => 12, 40, 100..120
+    static bool parseFrameList(const QString &text, std::vector<int> &out);
+};
+
+struct ExtractOptions
+{
+    QString outputDir;
+    SamplingRule rule;
+    double sceneThreshold = 0.0;   // > 0: also take frames where the content changed (see SceneDetector)
+    int sceneMinGap = 0;           // frames between two scene captures, 0 = half a second
+    int firstImageIndex = -1;      // -1 = continue after the largest number in outputDir
+                                   // (either way, numbers taken by other instances are skipped)
+    int threads = 0;               // decode + encode threads, 0 = one per core
+    int framesInFlight = 0;        // decoded frames waiting for the encoder, 0 = 4 per thread
+    int segmentsPerVideo = 0;      // 0 = auto: ~4 segments per thread spread by video length
+    int minSegmentFrames = 500;    // never cut pieces shorter than this
+    QString manifestPath;          // optional CSV: image,video,frame in frame order
+    ImageFormat format;            // codec + quality of the written images
+    qint64 shardBytes = 0;         // > 0: append to tar shards of at most this size (see ShardWriter)
+};
+
+struct ExtractStats
+{
+    int videos = 0;
+    int framesDecoded = 0;         // retrieved + converted
+    int framesSkipped = 0;         // grab() only
+    int imagesWritten = 0;
+    int imagesFailed = 0;
+    int imagesMissing = 0;         // planned but the video ended early (numbers left unused)
+    int nextImageIndex = 1;
+};
+
+// Headless extraction with the GUI's image_XXXX numbering.
+// Every video is probed first and every selected frame gets its image number
+// up front (videos in the given order), so the output is identical no matter
+// how the work is scheduled. Long videos are cut at keyframe boundaries into
+// segments, each decoded by its own cv::VideoCapture, so even a single file
+// keeps every core busy. Segments run as decode tasks on a work-stealing pool;
+// each decoded frame becomes a separate high-priority encode task.
+class FrameExtractor
+{
+public:
+    explicit FrameExtractor(const ExtractOptions &options);
+    ~FrameExtractor();
+
+    // Progress callback: (images done, images planned); called from worker threads, serialized
+    std::function<void(int, int)> onProgress;
+
+    ExtractStats extractAll(const QStringList &videos);
+
+    // Probe results from a catalog: videos it knows aren't opened just to read fps / frame count
+    void setCatalog(const VideoCatalog *catalog) { catalog_ = catalog; }
+
+private:
+    struct Segment
+    {
+        QString video;
+        int begin = 0;                 // first frame to decode
+        std::vector<int> frames;       // selected frames in [begin, next segment), ascending
+        int firstImage = 0;            // image number of frames[0]
+        bool exactStart = false;       // begin is a keyframe, so the seek lands exactly
+        std::shared_ptr<const std::vector<int>> keyframes;   // for jumping over gaps, may be empty
+    };
+
+    struct SceneCapture
+    {
+        int frame = 0;
+        QString tempPath;              // hidden file until the numbers are known
+        std::atomic<bool> ok{false};
+    };
+
+    struct VideoPlan
+    {
+        bool ok = false;
+        double fps = 30.0;
+        int frameCount = 0;
+        std::shared_ptr<const std::vector<int>> keyframes;   // from the GUI's cached index
+        std::vector<int> selected;
+    };
+
+    VideoPlan planVideo(const QString &videoPath) const;
+    std::vector<int> segmentStarts(const VideoPlan &plan, int pieces) const;
+    bool writeManifest(const QStringList &videos, const std::vector<VideoPlan> &plans) const;
+    void runSegment(WorkStealingPool &pool, const Segment &seg);
+    void writeToShard(const QString &path, const cv::Mat &frame, int image);
+    ExtractStats extractScenes(WorkStealingPool &pool, const QStringList &videos, std::vector<VideoPlan> &plans);
+    void runScenePass(WorkStealingPool &pool, const QString &video, double fps, std::deque<SceneCapture> &out);
+    bool finishSceneCapture(const QString &tempPath, int &number);
+    void reportProgress();
+
+    ExtractOptions opt_;
+    const VideoCatalog *catalog_ = nullptr;
+    std::vector<int> params_;        // opt_.format as imwrite parameters
+    ImageNumberReserver reserver_;   // shared counter in outputDir
+    std::unique_ptr<ShardWriter> shards_;
+    int nextIndex_ = 1;
+    int planned_ = 0;
+    int inFlightLimit_ = 16;
+
+    std::atomic<int> inFlight_{0};
+    std::atomic<int> decoded_{0};
+    std::atomic<int> skipped_{0};
+    std::atomic<int> written_{0};
+    std::atomic<int> failed_{0};
+    std::atomic<int> missing_{0};
+    std::vector<std::atomic<int>> writtenAs_;   // per planned image: number it was written as (0 = not written)
+    std::mutex progressMutex_;
+};
+
+#endif // FRAMEEXTRACTOR_H
@@ -0,0 +1,56 @@
+#include "framemetrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc.hpp>
+
+cv::Mat FrameMetrics::luma(const cv::Mat &bgr, int width)
+{
+    if (bgr.empty()) return cv::Mat();
+
+    cv::Mat small;
+    if (bgr.cols > width)
+    {
+        const int height = std::max(1, static_cast<int>(std::lround(double(bgr.rows) * width / bgr.cols)));
+        cv::resize(bgr, small, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+    }
+    else
+    {
+        small = bgr;
+    }
+
+    if (small.channels() == 1) return small;
+    cv::Mat gray;
+    cv::cvtColor(small, gray, small.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    return gray;
+}
+
+float FrameMetrics::sharpness(const cv::Mat &luma)
+{
+    if (luma.empty()) return 0.0f;
+
+    cv::Mat lap;
+    cv::Laplacian(luma, lap, CV_16S);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(lap, mean, stddev);
+    return static_cast<float>(stddev[0] * stddev[0]);
+}
+
+cv::Mat FrameMetrics::differenceThumbnail(const cv::Mat &luma)
+{
+    if (luma.empty() || luma.cols <= 64) return luma;
+    // The area resize also averages away noise and compression flicker
+    cv::Mat small;
+    const int height = std::max(1, static_cast<int>(std::lround(double(luma.rows) * 64 / luma.cols)));
+    cv::resize(luma, small, cv::Size(64, height), 0, 0, cv::INTER_AREA);
+    return small;
+}
+
+double FrameMetrics::difference(const cv::Mat &lumaA, const cv::Mat &lumaB)
+{
+    const cv::Mat a = differenceThumbnail(lumaA);
+    const cv::Mat b = differenceThumbnail(lumaB);
+    if (a.empty() || b.empty() || a.size() != b.size()) return 1.0;
+    return cv::norm(a, b, cv::NORM_L1) / (255.0 * a.total());
+}
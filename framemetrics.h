@@ -0,0 +1,26 @@
+#ifndef FRAMEMETRICS_H
+#define FRAMEMETRICS_H
+
+#include <opencv2/core.hpp>
+
+// Cheap per-frame measurements, run on the decoder threads.
+// Everything works on a small luma thumbnail: one area resize of the BGR
+// frame (OpenCV's vectorised path) and a colour conversion of the few
+// pixels that are left.
+class FrameMetrics
+{
+public:
+    // Gray thumbnail about `width` pixels wide (never upscaled)
+    static cv::Mat luma(const cv::Mat &bgr, int width = 320);
+
+    // Focus measure: variance of the Laplacian. Higher = sharper; only
+    // comparable between frames of the same video.
+    static float sharpness(const cv::Mat &luma);
+
+    // Content change between two luma thumbnails: mean absolute difference
+    // after shrinking both to 64 px wide, 0 (same) .. 1 (black vs white)
+    static double difference(const cv::Mat &lumaA, const cv::Mat &lumaB);
+    static cv::Mat differenceThumbnail(const cv::Mat &luma);   // precompute one side
+};
+
+#endif // FRAMEMETRICS_H
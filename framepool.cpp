@@ -0,0 +1,83 @@
+#include "framepool.h"
+
+#include "profiler.h"
+
+FramePool &FramePool::shared()
+{
+    static FramePool pool;
+    return pool;
+}
+
+void FramePool::setMaxIdleBytes(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxIdle_ = bytes;
+}
+
+cv::Mat FramePool::acquire(cv::Size size, int type)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++acquired_;
+
+    // Only the pool holds it => nobody else can see the memory change. Holders
+    // never add references to a buffer they already dropped, so this can't race.
+    for (const cv::Mat &m : buffers_)
+        if (m.size() == size && m.type() == type && idle(m))
+            return m;
+
+    ++allocated_;
+    cv::Mat fresh(size, type);
+
+    // Free idle buffers of another geometry (new video), then anything over the budget
+    size_t idleBytes = 0;
+    auto keep = buffers_.begin();
+    for (auto it = buffers_.begin(); it != buffers_.end(); ++it)
+    {
+        if (idle(*it))
+        {
+            const bool stale = it->size() != size || it->type() != type;
+            if (stale || idleBytes + sizeOf(*it) > maxIdle_) continue;
+            idleBytes += sizeOf(*it);
+        }
+        *keep++ = std::move(*it);
+    }
+    buffers_.erase(keep, buffers_.end());
+
+    buffers_.push_back(fresh);
+    return fresh;
+}
+
+bool FramePool::read(cv::VideoCapture &cap, cv::Mat &out, cv::Size &geometry)
+{
+    if (geometry.empty())
+        geometry = cv::Size(static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH)),
+                            static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT)));
+
+    // Let go of the previous frame first, it may be the only other user of a buffer
+    out.release();
+    if (!geometry.empty())
+        out = acquire(geometry, CV_8UC3);
+
+    // Every decode path goes through here, so this is the profiler's "decode" stage
+    PROFILE_SCOPE(Profiler::Decode);
+    if (!cap.read(out)) return false;
+
+    // Rotated or oddly reported streams: match what actually came out next time
+    geometry = out.size();
+    return true;
+}
+
+FramePool::Stats FramePool::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s;
+    s.acquired = acquired_;
+    s.allocated = allocated_;
+    s.buffers = static_cast<int>(buffers_.size());
+    for (const cv::Mat &m : buffers_)
+    {
+        s.bytes += sizeOf(m);
+        if (!idle(m)) ++s.inUse;
+    }
+    return s;
+}
@@ -0,0 +1,56 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <QtGlobal>
+
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+// Recycled full-size frame buffers shared by the decoder, cache, display and
+// save paths. Buffers are ordinary refcounted cv::Mats: whoever holds a frame
+// just keeps its Mat, and once the last holder lets go (cache eviction, save
+// written, ring popped) only the pool's own reference is left and the next
+// acquire() hands the same memory out again. No deep copies, no new pages
+// per frame once playback reached steady state.
+class FramePool
+{
+public:
+    struct Stats
+    {
+        quint64 acquired = 0;    // buffers handed out
+        quint64 allocated = 0;   // ... of which needed new memory
+        int buffers = 0;         // buffers the pool owns
+        int inUse = 0;           // ... held by someone right now
+        size_t bytes = 0;        // memory owned by the pool
+    };
+
+    // One pool per process
+    static FramePool &shared();
+
+    // Idle buffers kept for reuse beyond this are freed
+    void setMaxIdleBytes(size_t bytes);
+
+    // Buffer of exactly this geometry; contents are undefined
+    cv::Mat acquire(cv::Size size, int type);
+
+    // cap.read() into a pooled buffer. `geometry` remembers what the backend
+    // really delivers (0x0 = ask the capture), so the next call matches.
+    bool read(cv::VideoCapture &cap, cv::Mat &out, cv::Size &geometry);
+
+    Stats stats() const;
+
+private:
+    static bool idle(const cv::Mat &m) { return m.u && m.u->refcount == 1; }
+    static size_t sizeOf(const cv::Mat &m) { return m.total() * m.elemSize(); }
+
+    mutable std::mutex mutex_;
+    std::vector<cv::Mat> buffers_;
+    size_t maxIdle_ = size_t(256) * 1024 * 1024;
+    quint64 acquired_ = 0;
+    quint64 allocated_ = 0;
+};
+
+#endif // FRAMEPOOL_H
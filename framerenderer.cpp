@@ -0,0 +1,67 @@
+#include "framerenderer.h"
+
+#include "profiler.h"
+
+#include <algorithm>
+
+namespace {
+
+// cv::Mat header over the QImage pixels, no copy
+cv::Mat wrap(QImage &img)
+{
+    return cv::Mat(img.height(), img.width(), CV_8UC3, img.bits(), static_cast<size_t>(img.bytesPerLine()));
+}
+
+}
+
+QSize FrameRenderer::fitSize(const QSize &source, const QSize &target)
+{
+    if (source.isEmpty() || target.isEmpty()) return QSize();
+    QSize s = source.scaled(target, Qt::KeepAspectRatio);
+    return QSize(std::max(1, s.width()), std::max(1, s.height()));
+}
+
+const QImage &FrameRenderer::render(const cv::Mat &src, const QSize &target)
+{
+    if (src.empty()) return image_;
+
+    const QSize out = fitSize(QSize(src.cols, src.rows), target);
+    if (out.isEmpty()) return image_;
+
+    // Only allocate when the label size changes
+    if (image_.size() != out || image_.format() != QImage::Format_BGR888)
+        image_ = QImage(out, QImage::Format_BGR888);
+
+    // Area filter for downscaling (what we do 99% of the time), linear for upscaling
+    const int interp = (out.width() < src.cols) ? cv::INTER_AREA : cv::INTER_LINEAR;
+
+    if (src.channels() == 3)
+    {
+        // Common case: resize lands directly in the QImage, colours already match
+        cv::Mat dst = wrap(image_);
+        cv::resize(src, dst, dst.size(), 0, 0, interp);
+    }
+    else
+    {
+        cv::resize(src, scratch_, cv::Size(out.width(), out.height()), 0, 0, interp);
+        matToQImage(scratch_, image_);
+    }
+    return image_;
+}
+
+void FrameRenderer::matToQImage(const cv::Mat &src, QImage &dst)
+{
+    if (src.empty()) return;
+    PROFILE_SCOPE(Profiler::ToQImage);
+
+    if (dst.width() != src.cols || dst.height() != src.rows || dst.format() != QImage::Format_BGR888)
+        dst = QImage(src.cols, src.rows, QImage::Format_BGR888);
+
+    cv::Mat out = wrap(dst);
+    if (src.channels() == 3)
+        src.copyTo(out);
+    else if (src.channels() == 4)
+        cv::cvtColor(src, out, cv::COLOR_BGRA2BGR);
+    else
+        cv::cvtColor(src, out, cv::COLOR_GRAY2BGR);
+}
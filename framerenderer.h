@@ -0,0 +1,31 @@
+#ifndef FRAMERENDERER_H
+#define FRAMERENDERER_H
+
+#include <QImage>
+#include <QSize>
+
+#include <opencv2/opencv.hpp>
+
+// Turns a decoded frame into what the video label shows: downscale to the
+// label size first (area filter), then convert colour straight into a QImage
+// that is reused between frames. Only reallocates when the output size changes.
+class FrameRenderer
+{
+public:
+    // Fit src into target keeping the aspect ratio
+    const QImage &render(const cv::Mat &src, const QSize &target);
+
+    // Last rendered image (BGR888, null before the first render)
+    const QImage &image() const { return image_; }
+
+    // Colour-convert an already sized frame into dst's pixels (no copy if dst fits)
+    static void matToQImage(const cv::Mat &src, QImage &dst);
+
+    static QSize fitSize(const QSize &source, const QSize &target);
+
+private:
+    QImage image_;
+    cv::Mat scratch_;   // downscaled frame when src isn't 3-channel BGR
+};
+
+#endif // FRAMERENDERER_H
@@ -0,0 +1,58 @@
+#include "imageformat.h"
+
+#include <QStringList>
+
+#include <opencv2/imgcodecs.hpp>
+
+std::vector<int> ImageFormat::params() const
+{
+    if (quality < 0) return {};
+    if (codec == "png")  return { cv::IMWRITE_PNG_COMPRESSION, quality };
+    if (codec == "jpg")  return { cv::IMWRITE_JPEG_QUALITY, quality };
+    if (codec == "webp") return { cv::IMWRITE_WEBP_QUALITY, quality };
+    return {};
+}
+
+QString ImageFormat::toString() const
+{
+    return quality < 0 ? codec : QString("%1:%2").arg(codec).arg(quality);
+}
+
+bool ImageFormat::parse(const QString &text, ImageFormat &out)
+{
+    const QStringList parts = text.trimmed().toLower().split(':');
+    if (parts.isEmpty() || parts.size() > 2) return false;
+
+    ImageFormat f;
+    f.codec = parts[0] == "jpeg" ? QString("jpg") : parts[0];
+
+    int lo = 0, hi = -1;
+    if (f.codec == "png")       { lo = 0; hi = 9; }
+    else if (f.codec == "jpg")  { lo = 1; hi = 100; }
+    else if (f.codec == "webp") { lo = 1; hi = 101; }
+    else if (f.codec != "ppm" && f.codec != "bmp") return false;
+
+    if (parts.size() == 2)
+    {
+        bool ok = false;
+        f.quality = parts[1].toInt(&ok);
+        if (!ok || f.quality < lo || f.quality > hi) return false;
+    }
+    out = f;
+    return true;
+}
+
+QList<ImageFormat> ImageFormat::benchmarkSet()
+{
+    QList<ImageFormat> set;
+    for (const char *s : { "png:0", "png:1", "png:3", "png:6", "png:9",
+                           "jpg:75", "jpg:90", "jpg:95",
+                           "webp:80", "webp:95", "webp:101",
+                           "ppm", "bmp" })
+    {
+        ImageFormat f;
+        parse(QString::fromLatin1(s), f);
+        set << f;
+    }
+    return set;
+}
@@ -0,0 +1,31 @@
+#ifndef IMAGEFORMAT_H
+#define IMAGEFORMAT_H
+
+#include <QList>
+#include <QString>
+
+#include <vector>
+
+// Output codec + quality, written as "codec[:quality]" in the config and on
+// the command line:
+//   png[:0-9]     compression level (higher = smaller, slower)
+//   jpg[:1-100]   quality
+//   webp[:1-101]  quality, 101 = lossless
+//   ppm, bmp      uncompressed, for staging
+// No quality = OpenCV's default for that codec.
+struct ImageFormat
+{
+    QString codec = "png";
+    int quality = -1;
+
+    QString extension() const { return codec; }
+    std::vector<int> params() const;          // for cv::imwrite / cv::imencode
+    QString toString() const;
+
+    static bool parse(const QString &text, ImageFormat &out);
+
+    // Settings tried by the codec benchmark
+    static QList<ImageFormat> benchmarkSet();
+};
+
+#endif // IMAGEFORMAT_H
@@ -0,0 +1,349 @@
+#include "imagehashindex.h"
+
+#include "datasetdir.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+const quint32 kMagic = 0x56444849;   // "VDHI"
+const quint32 kVersion = 1;
+const int kMaxDistance = 11;         // radius 2 per 16-bit chunk
+
+// image_0042.png -> 42 (last digit run of the base name), -1 if none
+int numberFromName(const QString &fileName)
+{
+    const QString base = QFileInfo(fileName).completeBaseName();
+    int end = base.size();
+    while (end > 0 && !base.at(end - 1).isDigit()) --end;
+    int begin = end;
+    while (begin > 0 && base.at(begin - 1).isDigit()) --begin;
+    bool ok = false;
+    const int n = base.mid(begin, end - begin).toInt(&ok);
+    return ok ? n : -1;
+}
+
+// An image file, or a member of a tar shard (offset of its data + size)
+struct Source
+{
+    QString path;
+    qint64 offset;
+    qint64 size;
+};
+
+cv::Mat readReduced(const Source &src)
+{
+    if (src.offset < 0)
+        return cv::imread(src.path.toStdString(), cv::IMREAD_REDUCED_GRAYSCALE_8);
+
+    QFile f(src.path);
+    if (!f.open(QIODevice::ReadOnly) || !f.seek(src.offset)) return cv::Mat();
+    const QByteArray bytes = f.read(src.size);
+    if (bytes.size() != src.size) return cv::Mat();
+    const cv::Mat buf(1, static_cast<int>(bytes.size()), CV_8U, const_cast<char *>(bytes.constData()));
+    return cv::imdecode(buf, cv::IMREAD_REDUCED_GRAYSCALE_8);
+}
+
+} // namespace
+
+ImageHashIndex::ImageHashIndex()
+{
+    for (auto &table : tables_)
+        table.resize(1 << 16);
+}
+
+ImageHashIndex::~ImageHashIndex()
+{
+    stopLoader();
+}
+
+quint64 ImageHashIndex::dHash(const cv::Mat &image)
+{
+    if (image.empty()) return 0;
+
+    // Area resize straight to 9x8 (OpenCV's SIMD path), colour conversion on 72 pixels only
+    cv::Mat small, gray;
+    cv::resize(image, small, cv::Size(9, 8), 0, 0, cv::INTER_AREA);
+    if (small.channels() == 3)      cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+    else if (small.channels() == 4) cv::cvtColor(small, gray, cv::COLOR_BGRA2GRAY);
+    else                            gray = small;
+
+    quint64 hash = 0;
+    for (int y = 0; y < 8; ++y)
+    {
+        const uchar *row = gray.ptr<uchar>(y);
+        for (int x = 0; x < 8; ++x)
+            hash = (hash << 1) | (row[x] < row[x + 1] ? 1u : 0u);
+    }
+    return hash;
+}
+
+int ImageHashIndex::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(hashes_.size());
+}
+
+// ================== Lookup ==================
+
+ImageHashIndex::Match ImageHashIndex::nearest(quint64 hash, int maxDistance) const
+{
+    const int d = std::clamp(maxDistance, 0, kMaxDistance);
+    const int radius = d / kChunks;   // pigeonhole: some chunk is at most this far off
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Match best;
+
+    auto probe = [&](int chunk, quint32 bucket) {
+        for (quint32 id : tables_[chunk][bucket])
+        {
+            if (numbers_[id] < 0) continue;
+            const int dist = qPopulationCount(hashes_[id] ^ hash);
+            if (dist <= d && dist < best.distance)
+            {
+                best.distance = dist;
+                best.number = numbers_[id];
+            }
+        }
+    };
+
+    for (int c = 0; c < kChunks; ++c)
+    {
+        const quint32 v = static_cast<quint32>(hash >> (16 * c)) & 0xffff;
+        probe(c, v);
+        for (int i = 0; radius >= 1 && i < 16; ++i)
+        {
+            probe(c, v ^ (1u << i));
+            for (int j = i + 1; radius >= 2 && j < 16; ++j)
+                probe(c, v ^ (1u << i) ^ (1u << j));
+        }
+    }
+    return best;
+}
+
+// ================== Updates ==================
+
+void ImageHashIndex::add(int number, quint64 hash)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_[number] = static_cast<quint32>(hashes_.size());
+    addLocked(number, hash);
+}
+
+void ImageHashIndex::addLocked(int number, quint64 hash)
+{
+    const quint32 id = static_cast<quint32>(hashes_.size());
+    hashes_.push_back(hash);
+    numbers_.push_back(number);
+    for (int c = 0; c < kChunks; ++c)
+        tables_[c][static_cast<quint32>(hash >> (16 * c)) & 0xffff].push_back(id);
+}
+
+void ImageHashIndex::commit(int number, int savedAs)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pending_.find(number);
+    if (it == pending_.end()) return;
+    const quint32 id = it->second;
+    pending_.erase(it);
+    numbers_[id] = savedAs;
+
+    // Still loading: the loader writes it out together with its own records
+    if (ready_ && !file_.isEmpty())
+        appendRecords(file_, { { numbers_[id], hashes_[id] } });
+}
+
+void ImageHashIndex::remove(int number)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pending_.find(number);
+    if (it == pending_.end()) return;
+    numbers_[it->second] = -1;   // ids stay valid, the tables just skip it
+    pending_.erase(it);
+}
+
+// ================== Loading ==================
+
+void ImageHashIndex::stopLoader()
+{
+    cancel_ = true;
+    if (loader_.joinable()) loader_.join();
+    cancel_ = false;
+}
+
+void ImageHashIndex::setDirectory(const QString &dirPath)
+{
+    stopLoader();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    hashes_.clear();
+    numbers_.clear();
+    pending_.clear();
+    for (auto &table : tables_)
+        for (auto &bucket : table)
+            bucket.clear();
+
+    dir_ = dirPath;
+    file_ = dirPath.isEmpty() ? QString() : cachePathFor(dirPath);
+    ready_ = dirPath.isEmpty();
+    if (!ready_)
+        loader_ = std::thread(&ImageHashIndex::load, this, dir_, file_);
+}
+
+void ImageHashIndex::load(const QString &dir, const QString &file)
+{
+    // What the cache knows (last record per number wins) ...
+    std::unordered_map<int, quint64> cachedHashes;
+    bool cached = false;
+    bool compact = false;   // duplicate or stale records: rewrite instead of appending
+    {
+        QFile f(file);
+        if (f.open(QIODevice::ReadOnly))
+        {
+            QDataStream in(&f);
+            quint32 magic = 0, version = 0;
+            in >> magic >> version;
+            cached = magic == kMagic && version == kVersion;
+            while (cached && !in.atEnd() && !cancel_)
+            {
+                qint32 number = 0;
+                quint64 hash = 0;
+                in >> number >> hash;
+                if (in.status() != QDataStream::Ok) break;   // torn last record
+                if (!cachedHashes.emplace(number, hash).second)
+                {
+                    cachedHashes[number] = hash;
+                    compact = true;
+                }
+            }
+        }
+    }
+
+    // ... against what is on disk now. Names only; images deleted since are
+    // dropped, ones written by vdt-extract or another instance get hashed.
+    std::unordered_map<int, Source> onDisk;
+    QDirIterator it(dir, DatasetDir::imageNameFilters(), QDir::Files | QDir::Readable);
+    while (it.hasNext() && !cancel_)
+    {
+        const QString path = it.next();
+        const int number = numberFromName(path);
+        if (number >= 0) onDisk.emplace(number, Source{ path, -1, 0 });
+    }
+    // Shard members, from the .idx next to each finished shard
+    QDirIterator shards(dir, DatasetDir::shardNameFilters(), QDir::Files | QDir::Readable);
+    while (shards.hasNext() && !cancel_)
+    {
+        const QString tar = shards.next();
+        QFile idx(tar.left(tar.size() - 4) + ".idx");
+        if (!idx.open(QIODevice::ReadOnly)) continue;
+        while (!idx.atEnd())
+        {
+            const QList<QByteArray> fields = idx.readLine().trimmed().split('\t');
+            if (fields.size() != 3) continue;
+            const int number = numberFromName(QString::fromUtf8(fields[0]));
+            if (number >= 0) onDisk.emplace(number, Source{ tar, fields[1].toLongLong(), fields[2].toLongLong() });
+        }
+    }
+    if (cancel_) return;
+
+    std::vector<std::pair<int, quint64>> records;
+    records.reserve(onDisk.size());
+    for (const auto &c : cachedHashes)
+    {
+        if (onDisk.count(c.first)) records.emplace_back(c.first, c.second);
+        else compact = true;
+    }
+
+    // Reduced decode (1/8 size, JPEG does it in the DCT) is plenty for a 9x8 hash
+    std::vector<std::pair<int, quint64>> fresh;
+    for (const auto &d : onDisk)
+    {
+        if (cancel_) return;
+        if (cachedHashes.count(d.first)) continue;
+        const cv::Mat img = readReduced(d.second);
+        if (!img.empty())
+            fresh.emplace_back(d.first, dHash(img));
+    }
+    records.insert(records.end(), fresh.begin(), fresh.end());
+
+    const bool rewrite = !cached || compact;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Entries added meanwhile get new ids behind the loaded ones
+    std::vector<std::pair<int, quint64>> added;
+    for (size_t id = 0; id < hashes_.size(); ++id)
+        added.emplace_back(numbers_[id], hashes_[id]);
+    std::unordered_map<int, quint64> stillPending;
+    for (const auto &p : pending_)
+        stillPending[p.first] = hashes_[p.second];
+
+    hashes_.clear();
+    numbers_.clear();
+    pending_.clear();
+    for (auto &table : tables_)
+        for (auto &bucket : table)
+            bucket.clear();
+
+    hashes_.reserve(records.size() + added.size());
+    numbers_.reserve(records.size() + added.size());
+    std::unordered_map<int, quint64> loaded;
+    for (const auto &r : records)
+    {
+        addLocked(r.first, r.second);
+        loaded.emplace(r.first, r.second);
+    }
+
+    std::vector<std::pair<int, quint64>> toWrite = rewrite ? records : fresh;
+    for (const auto &a : added)
+    {
+        if (a.first < 0) continue;   // removed while loading
+        const bool pending = stillPending.count(a.first) > 0;
+        if (!pending && loaded.count(a.first)) continue;   // written meanwhile, the listing saw it
+        if (pending)
+            pending_[a.first] = static_cast<quint32>(hashes_.size());
+        else
+            toWrite.push_back(a);    // committed while loading
+        addLocked(a.first, a.second);
+    }
+    // Other version, garbage or stale entries: start the file over
+    if (rewrite)
+        QFile::remove(file);
+    if (!toWrite.empty() || rewrite)
+        appendRecords(file, toWrite);
+    ready_ = true;
+}
+
+bool ImageHashIndex::appendRecords(const QString &file, const std::vector<std::pair<int, quint64>> &records) const
+{
+    QDir().mkpath(QFileInfo(file).absolutePath());
+    QFile f(file);
+    const bool fresh = !f.exists();
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Append)) return false;
+
+    QDataStream out(&f);
+    if (fresh)
+        out << kMagic << kVersion;
+    for (const auto &r : records)
+        out << qint32(r.first) << quint64(r.second);
+    return out.status() == QDataStream::Ok;
+}
+
+QString ImageHashIndex::cachePathFor(const QString &dirPath) const
+{
+    const QString abs = QFileInfo(dirPath).absoluteFilePath();
+    const QByteArray key = QCryptographicHash::hash(abs.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+           + QDir::separator() + "hashindex" + QDir::separator() + QString::fromLatin1(key) + ".vhi";
+}
@@ -0,0 +1,75 @@
+#ifndef IMAGEHASHINDEX_H
+#define IMAGEHASHINDEX_H
+
+#include <QString>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// 64-bit difference hashes (dHash) of the images in a save directory, for
+// catching near-duplicate captures before they are written.
+// Lookups use multi-index hashing: the hash is split into four 16-bit chunks,
+// each with its own table, and a match within distance d must agree with the
+// query on some chunk within d/4 bits. So a query at d <= 7 probes 4 x 17
+// buckets (about 1000 candidates at 1M images) instead of every entry.
+// Persisted per folder in <AppData>/hashindex as an append-only file. Loading
+// (in the background) checks it against the folder listing, shard .idx files
+// included: deleted images are dropped, images written by someone else are
+// hashed (reduced decode).
+class ImageHashIndex
+{
+public:
+    struct Match
+    {
+        int number = -1;      // image number of the closest entry, -1 if none within range
+        int distance = 65;    // Hamming distance
+    };
+
+    ImageHashIndex();
+    ~ImageHashIndex();
+
+    static quint64 dHash(const cv::Mat &image);       // BGR or gray
+
+    // Loads (or builds) the index for dirPath in the background
+    void setDirectory(const QString &dirPath);
+    bool isReady() const { return ready_; }
+    int size() const;
+
+    // Closest entry within maxDistance (clamped to 11 = radius 2 per chunk)
+    Match nearest(quint64 hash, int maxDistance) const;
+
+    // In memory right away (so the next capture already sees it) ...
+    void add(int number, quint64 hash);
+    // ... and on disk once the image really got written (as savedAs, which differs
+    // if the save was renumbered), or dropped if it didn't
+    void commit(int number, int savedAs);
+    void remove(int number);
+
+private:
+    static const int kChunks = 4;
+
+    void stopLoader();
+    void load(const QString &dir, const QString &file);
+    void addLocked(int number, quint64 hash);
+    bool appendRecords(const QString &file, const std::vector<std::pair<int, quint64>> &records) const;
+    QString cachePathFor(const QString &dirPath) const;
+
+    mutable std::mutex mutex_;
+    std::vector<quint64> hashes_;
+    std::vector<int> numbers_;                         // -1 = removed
+    std::vector<std::vector<quint32>> tables_[kChunks];   // chunk value -> entry ids
+    std::unordered_map<int, quint32> pending_;         // added, not on disk yet
+
+    QString dir_;
+    QString file_;
+    std::thread loader_;
+    std::atomic<bool> cancel_{false};
+    std::atomic<bool> ready_{false};
+};
+
+#endif // IMAGEHASHINDEX_H
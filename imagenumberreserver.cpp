@@ -0,0 +1,170 @@
+#include "imagenumberreserver.h"
+
+#include <QDir>
+#include <QFile>
+#include <QLockFile>
+#include <QSaveFile>
+
+#include <algorithm>
+
+namespace {
+
+const char *kCounterName = ".vdt_next";
+const int kStaleLockMs = 30000;    // a crashed instance doesn't block everybody forever
+// Releasing runs on folder switch and exit (GUI thread): a gap beats a frozen window
+const int kReleaseTimeoutMs = 250;
+
+bool readCounter(const QString &path, int &value)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    bool ok = false;
+    value = QString::fromLatin1(f.readAll()).trimmed().toInt(&ok);
+    return ok;
+}
+
+bool writeCounter(const QString &path, int value)
+{
+    // Written under the lock; QSaveFile so a crash never leaves half a number
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) return false;
+    f.write(QByteArray::number(value) + '\n');
+    return f.commit();
+}
+
+} // namespace
+
+ImageNumberReserver::ImageNumberReserver(int blockSize)
+    : blockSize_(std::max(1, blockSize))
+{
+}
+
+ImageNumberReserver::~ImageNumberReserver()
+{
+    releaseUnused();
+}
+
+void ImageNumberReserver::setDirectory(const QString &dirPath)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dirPath == dir_) return;
+    releaseLocked();
+    dir_ = dirPath;
+}
+
+QString ImageNumberReserver::directory() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dir_;
+}
+
+void ImageNumberReserver::setBlockSize(int n)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    blockSize_ = std::max(1, n);
+}
+
+int ImageNumberReserver::next(int floor, int lockTimeoutMs)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Local numbers below floor are useless (someone wrote past them), drop them
+    if (blockNext_ < floor) blockNext_ = std::min(floor, blockEnd_);
+
+    if (blockNext_ >= blockEnd_)
+    {
+        const int first = reserveLocked(blockSize_, floor, lockTimeoutMs);
+        if (first < 0) return -1;
+        blockNext_ = first;
+        blockEnd_ = first + blockSize_;
+    }
+    return blockNext_++;
+}
+
+int ImageNumberReserver::reserveBlock(int count, int floor, int lockTimeoutMs)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return reserveLocked(std::max(1, count), floor, lockTimeoutMs);
+}
+
+void ImageNumberReserver::giveBack(int number)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (number + 1 == blockNext_) --blockNext_;
+}
+
+bool ImageNumberReserver::giveBackBlock(int first, int end, int lockTimeoutMs)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (first >= end) return true;
+    if (dir_.isEmpty()) return false;
+
+    const QString path = counterPath();
+    QLockFile fileLock(path + ".lock");
+    fileLock.setStaleLockTime(kStaleLockMs);
+    if (!fileLock.tryLock(lockTimeoutMs)) return false;
+
+    // Same rule as releaseLocked(): only if we still own the top of the counter
+    int next = 0;
+    return readCounter(path, next) && next == end && writeCounter(path, first);
+}
+
+void ImageNumberReserver::releaseUnused()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    releaseLocked();
+}
+
+int ImageNumberReserver::peekCounter(const QString &dirPath)
+{
+    int value = 0;
+    if (dirPath.isEmpty() || !readCounter(QDir(dirPath).filePath(kCounterName), value)) return -1;
+    return value;
+}
+
+QString ImageNumberReserver::counterPath() const
+{
+    return QDir(dir_).filePath(kCounterName);
+}
+
+int ImageNumberReserver::reserveLocked(int count, int floor, int lockTimeoutMs)
+{
+    if (dir_.isEmpty()) return -1;
+    QDir().mkpath(dir_);
+
+    const QString path = counterPath();
+    QLockFile lock(path + ".lock");
+    lock.setStaleLockTime(kStaleLockMs);
+    if (!lock.tryLock(lockTimeoutMs)) return -1;
+
+    // No counter yet (first reservation here, or an older version wrote the
+    // folder): the floor is the caller's view of the folder. Anything it missed
+    // is caught by the exclusive write and renumbered.
+    int next = 0;
+    if (!readCounter(path, next))
+        next = floor;
+    const int first = std::max(next, floor);
+    if (!writeCounter(path, first + count)) return -1;
+    return first;
+}
+
+void ImageNumberReserver::releaseLocked()
+{
+    if (blockNext_ >= blockEnd_ || dir_.isEmpty())
+    {
+        blockNext_ = blockEnd_ = 0;
+        return;
+    }
+
+    const QString path = counterPath();
+    QLockFile lock(path + ".lock");
+    lock.setStaleLockTime(kStaleLockMs);
+    if (lock.tryLock(kReleaseTimeoutMs))
+    {
+        // Only if we still own the top of the counter
+        int next = 0;
+        if (readCounter(path, next) && next == blockEnd_)
+            writeCounter(path, blockNext_);
+    }
+    blockNext_ = blockEnd_ = 0;
+}
@@ -0,0 +1,66 @@
+#ifndef IMAGENUMBERRESERVER_H
+#define IMAGENUMBERRESERVER_H
+
+#include <QString>
+
+#include <mutex>
+
+// Hands out image numbers for a save directory that several processes (or
+// machines, on a network share) write into at the same time.
+// The next free number lives in <dir>/.vdt_next, guarded by <dir>/.vdt_next.lock
+// (QLockFile). Each process takes a block of numbers per lock round-trip and
+// serves single numbers from it locally, so ten annotators don't fight over
+// the lock on every capture. Unused numbers of the last block are handed back
+// on exit if nobody reserved after us and the lock is free right away;
+// otherwise they stay as gaps.
+// A folder without a counter yet starts at the caller's floor (which already
+// knows the largest number on disk), so reserving never lists the folder.
+// Thread-safe.
+class ImageNumberReserver
+{
+public:
+    explicit ImageNumberReserver(int blockSize = 16);
+    ~ImageNumberReserver();
+
+    void setDirectory(const QString &dirPath);
+    QString directory() const;
+
+    void setBlockSize(int n);
+
+    // How long to wait for another instance's lock. Workers and vdt-extract can
+    // wait; the GUI thread passes a short timeout and asks the user to retry.
+    static const int kLockTimeoutMs = 10000;
+
+    // One number >= floor. -1 if the lock couldn't be taken.
+    int next(int floor = 1, int lockTimeoutMs = kLockTimeoutMs);
+
+    // count consecutive numbers >= floor (bypasses the local block). -1 on failure.
+    int reserveBlock(int count, int floor = 1, int lockTimeoutMs = kLockTimeoutMs);
+
+    // Undo next() when the number ended up unused (e.g. the save queue was full)
+    void giveBack(int number);
+
+    // Undo the unused tail [first, end) of a reserveBlock() (cancelled range
+    // capture). Only works if nobody reserved after it; false leaves a gap.
+    bool giveBackBlock(int first, int end, int lockTimeoutMs = kLockTimeoutMs);
+
+    // Return what's left of the local block to the shared counter if possible
+    void releaseUnused();
+
+    // The folder's counter as it is right now, without the lock (-1 if there is
+    // none). Every number below it has been handed to some instance.
+    static int peekCounter(const QString &dirPath);
+
+private:
+    int reserveLocked(int count, int floor, int lockTimeoutMs);   // caller holds mutex_
+    void releaseLocked();
+    QString counterPath() const;
+
+    mutable std::mutex mutex_;
+    QString dir_;
+    int blockSize_ = 16;
+    int blockNext_ = 0;    // local block [blockNext_, blockEnd_)
+    int blockEnd_ = 0;
+};
+
+#endif // IMAGENUMBERRESERVER_H
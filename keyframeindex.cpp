@@ -0,0 +1,185 @@
+#include "keyframeindex.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+
+// Raw packet reading + key frame flag landed in OpenCV 4.7 (FFmpeg backend)
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7)
+#define VDT_HAVE_RAW_KEYFRAMES 1
+#endif
+
+namespace {
+const quint32 kMagic = 0x56444B46;   // "VDKF"
+const quint32 kVersion = 1;
+const qint64 kMaxCacheBytes = 64 * 1024 * 1024;   // a few thousand long videos
+const int kMaxCacheFiles = 10000;
+
+// Drop the least recently used indexes (load() touches what it reads)
+void pruneCache(const QString &dir)
+{
+    const QFileInfoList files = QDir(dir).entryInfoList({ "*.kfi" }, QDir::Files, QDir::Time);
+    qint64 bytes = 0;
+    for (int i = 0; i < files.size(); ++i)
+    {
+        bytes += files[i].size();
+        if (i >= kMaxCacheFiles || bytes > kMaxCacheBytes)
+            QFile::remove(files[i].absoluteFilePath());
+    }
+}
+}
+
+int KeyframeIndex::keyframeAtOrBefore(int frame) const
+{
+    if (keyframes_.empty()) return 0;
+    auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), frame);
+    if (it == keyframes_.begin()) return keyframes_.front();
+    return *(it - 1);
+}
+
+int KeyframeIndex::keyframeAfter(int frame) const
+{
+    auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), frame);
+    return it == keyframes_.end() ? frameCount_ : *it;
+}
+
+bool KeyframeIndex::canReadKeyframes()
+{
+#ifdef VDT_HAVE_RAW_KEYFRAMES
+    return true;
+#else
+    return false;
+#endif
+}
+
+QString KeyframeIndex::cachePathFor(const QString &videoPath)
+{
+    const QString abs = QFileInfo(videoPath).absoluteFilePath();
+    const QByteArray key = QCryptographicHash::hash(abs.toUtf8(), QCryptographicHash::Sha1).toHex();
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                        + QDir::separator() + "keyframes";
+    return dir + QDir::separator() + QString::fromLatin1(key) + ".kfi";
+}
+
+KeyframeIndex KeyframeIndex::load(const QString &videoPath)
+{
+    KeyframeIndex idx;
+    const QFileInfo fi(videoPath);
+    QFile f(cachePathFor(videoPath));
+    if (!fi.exists() || !f.open(QIODevice::ReadOnly)) return idx;
+
+    QDataStream in(&f);
+    quint32 magic = 0, version = 0;
+    qint64 size = 0, mtime = 0;
+    qint32 frames = 0;
+    quint32 n = 0;
+    in >> magic >> version >> size >> mtime >> frames >> n;
+    if (magic != kMagic || version != kVersion) return idx;
+    // Stale if the video changed since we indexed it
+    if (size != fi.size() || mtime != fi.lastModified().toMSecsSinceEpoch()) return idx;
+
+    // The count must match what is left of the file: a truncated or corrupt
+    // cache is a miss, not a multi-gigabyte reserve
+    if (in.status() != QDataStream::Ok || qint64(n) * qint64(sizeof(qint32)) != f.size() - f.pos()) return idx;
+
+    std::vector<int> kfs;
+    kfs.reserve(n);
+    for (quint32 i = 0; i < n && !in.atEnd(); ++i)
+    {
+        qint32 k = 0;
+        in >> k;
+        kfs.push_back(k);
+    }
+    if (in.status() != QDataStream::Ok || kfs.size() != n) return idx;
+
+    idx.frameCount_ = frames;
+    idx.keyframes_ = std::move(kfs);
+    f.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return idx;
+}
+
+bool KeyframeIndex::save(const QString &videoPath) const
+{
+    if (!isValid()) return false;
+
+    const QFileInfo fi(videoPath);
+    const QString path = cachePathFor(videoPath);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&f);
+    out << kMagic << kVersion
+        << qint64(fi.size()) << qint64(fi.lastModified().toMSecsSinceEpoch())
+        << qint32(frameCount_) << quint32(keyframes_.size());
+    for (int k : keyframes_)
+        out << qint32(k);
+    if (!f.commit()) return false;
+
+    pruneCache(QFileInfo(path).absolutePath());
+    return true;
+}
+
+KeyframeIndex KeyframeIndex::build(const QString &videoPath, const std::atomic<bool> *cancel)
+{
+    KeyframeIndex idx;
+    const std::string path = videoPath.toStdString();
+    auto cancelled = [cancel]() { return cancel && cancel->load(); };
+
+    int frames = 0;
+    std::vector<int> kfs;
+
+#ifdef VDT_HAVE_RAW_KEYFRAMES
+    // Fast path: read compressed packets only, the demuxer tells us which are keyframes
+    {
+        cv::VideoCapture raw;
+        try {
+            raw.open(path, cv::CAP_FFMPEG, { cv::CAP_PROP_FORMAT, -1 });
+        } catch (const cv::Exception &) {
+        }
+        if (raw.isOpened())
+        {
+            while (!cancelled() && raw.grab())
+            {
+                if (raw.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) != 0.0)
+                    kfs.push_back(frames);
+                ++frames;
+            }
+            if (cancelled()) return idx;
+        }
+    }
+#endif
+
+    // No packet reading (older OpenCV, other backend): decoding every frame just
+    // for the exact count isn't worth a core per open clip. Seeking keeps using
+    // CAP_PROP_POS_FRAMES and the count stays the container's.
+    if (frames == 0) return idx;
+
+    // A stream always starts decodable at frame 0
+    if (!kfs.empty() && kfs.front() != 0)
+        kfs.insert(kfs.begin(), 0);
+
+    idx.frameCount_ = frames;
+    idx.keyframes_ = std::move(kfs);
+    return idx;
+}
+
+KeyframeIndex KeyframeIndex::loadOrBuild(const QString &videoPath, const std::atomic<bool> *cancel)
+{
+    KeyframeIndex idx = load(videoPath);
+    if (idx.isValid()) return idx;
+
+    idx = build(videoPath, cancel);
+    if (idx.isValid()) idx.save(videoPath);
+    return idx;
+}
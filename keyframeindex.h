@@ -0,0 +1,50 @@
+#ifndef KEYFRAMEINDEX_H
+#define KEYFRAMEINDEX_H
+
+#include <QString>
+
+#include <atomic>
+#include <vector>
+
+// Keyframe (GOP start) positions of one video plus its real frame count.
+// Built once per file in the background and cached in the app-data folder
+// (least recently used dropped past 64 MB), keyed by file size + mtime, so
+// seeks can jump to the keyframe before the target and decode forward instead
+// of trusting CAP_PROP_POS_FRAMES.
+class KeyframeIndex
+{
+public:
+    bool isValid() const { return frameCount_ > 0; }
+    bool hasKeyframes() const { return !keyframes_.empty(); }
+    int frameCount() const { return frameCount_; }
+    const std::vector<int> &keyframes() const { return keyframes_; }
+
+    // Nearest keyframe <= frame (0 if unknown)
+    int keyframeAtOrBefore(int frame) const;
+    // Nearest keyframe > frame (frameCount() if none)
+    int keyframeAfter(int frame) const;
+
+    // This OpenCV build can read packets + key flags without decoding.
+    // Without it there is nothing cheap to build from: build() gives up.
+    static bool canReadKeyframes();
+
+    // Cache file for a video: <AppData>/keyframes/<sha1 of path>.kfi
+    static QString cachePathFor(const QString &videoPath);
+
+    // Load the cached index if it still matches the file on disk
+    static KeyframeIndex load(const QString &videoPath);
+    bool save(const QString &videoPath) const;
+
+    // Walk the file's packets. Returns an invalid index if cancelled, the file
+    // can't be read or the backend can't read packets (nothing gets decoded).
+    static KeyframeIndex build(const QString &videoPath, const std::atomic<bool> *cancel = nullptr);
+
+    // Cached index if present, otherwise build + cache it
+    static KeyframeIndex loadOrBuild(const QString &videoPath, const std::atomic<bool> *cancel = nullptr);
+
+private:
+    int frameCount_ = 0;
+    std::vector<int> keyframes_;   // sorted, empty if the backend can't tell keyframes
+};
+
+#endif // KEYFRAMEINDEX_H
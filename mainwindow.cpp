@@ -2,11 +2,35 @@
 #include "./ui_mainwindow.h"
 
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QStandardPaths>
 #include <QDateTime>
 #include <QMessageBox>
 #include <QKeyEvent>
 #include <QTextStream>
+#include <QPainter>
+#include <QInputDialog>
+#include <QStyleOptionSlider>
+#include <QScreen>
+#include <QAbstractSpinBox>
+#include <QApplication>
+#include <QComboBox>
+#include <QLineEdit>
+#include <QPlainTextEdit>
+#include <QTextEdit>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#include "datasetdir.h"
+#include "framepool.h"
+#include "profiler.h"
+
+namespace {
+// Reserving a number happens on the GUI thread: a busy share gets a retry, not a frozen window
+const int kReserveTimeoutMs = 250;
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -65,7 +89,7 @@ MainWindow::MainWindow(QWidget *parent)
     // Let the video area expand with the window
     ui->videoLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
     ui->videoLabel->setMinimumSize(1, 1);
-    ui->videoLabel->setScaledContents(false); // we scale manually in displayMat()
+    ui->videoLabel->setScaledContents(false); // we scale manually in displayMat() and paint in eventFilter()
 
     // kill extra margins around the video
     if (ui->videoGroupLayout) ui->videoGroupLayout->setContentsMargins(0,0,0,0);
@@ -80,12 +104,79 @@ MainWindow::MainWindow(QWidget *parent)
     configPath_ = appData + QDir::separator() + "config.txt";
 
     loadConfig();
+
+    // Numbering follows the save dir; a background scan may raise it later
+    connect(&saveDirIndex_, &SaveDirIndex::largestNumberChanged, this, [this](int n) {
+        nextImageIndex_ = std::max(nextImageIndex_, n + 1);
+        updateInfoLabels();
+    });
+    // Our own in-flight saves don't make it relist the folder
+    saveDirIndex_.ownWritesPending = [this]() {
+        return saveQueue_.pending() > 0 || rangeCapture_.isRunning();
+    };
+    saveDirIndex_.setDirectory(saveDirPath_);
+    reserver_.setDirectory(saveDirPath_);
+    hashIndex_.setDirectory(dedupMode_ != "off" ? saveDirPath_ : QString());
     recalcNextImageFromDir();
     updateInfoLabels();
 
     // Connect timer for playback
     connect(&timer_, &QTimer::timeout, this, &MainWindow::tick);
 
+    // Decoder thread tells us when a frame is ready (queued onto the GUI thread).
+    // Two decoders: the current clip and the next one of the playlist, opened ahead.
+    for (FrameDecoder *d : { &decoderA_, &decoderB_ })
+    {
+        d->setCapacity(prefetchFrames_);
+        d->cache().setBudgetBytes(size_t(cacheMB_) * 1024 * 1024);
+        connect(d, &FrameDecoder::frameAvailable, this, &MainWindow::onFrameAvailable, Qt::QueuedConnection);
+        connect(d, &FrameDecoder::indexReady, this, &MainWindow::onIndexReady, Qt::QueuedConnection);
+    }
+    // Backwards playback holds about two GOP chunks of up to half that budget
+    reverseDecoder_.setBudgetBytes(size_t(std::max(64, cacheMB_ / 2)) * 1024 * 1024);
+    reverseDecoder_.setCache(&decoder_->cache());
+
+    // Background encoder threads report back once the file is on disk
+    saveQueue_.setMaxPending(saveQueueLimit_);
+    saveQueue_.setReserver(&reserver_);
+    saveQueue_.setWorkerCount(saveWorkers_);
+    connect(&saveQueue_, &SaveQueue::saved, this, &MainWindow::onFrameSaved, Qt::QueuedConnection);
+    setupShards();
+
+    // Range capture runs on its own thread; progress comes back queued
+    connect(&rangeCapture_, &RangeCapture::progress, this, &MainWindow::onRangeProgress, Qt::QueuedConnection);
+    connect(&rangeCapture_, &RangeCapture::finished, this, &MainWindow::onRangeFinished, Qt::QueuedConnection);
+
+    // Transparent layer over the slider for the in/out marks
+    sliderOverlay_ = new QWidget(ui->timeSlider);
+    sliderOverlay_->setAttribute(Qt::WA_TransparentForMouseEvents);
+    sliderOverlay_->setGeometry(ui->timeSlider->rect());
+    sliderOverlay_->installEventFilter(this);
+
+    // Sharpness curve: repaint a few times a second at most, and only when the decoder measured something new
+    metricsTimer_.setInterval(250);
+    connect(&metricsTimer_, &QTimer::timeout, this, [this]() {
+        if (showSharpness_ && decoder_->metricsVersion() != shownMetricsVersion_)
+            sliderOverlay_->update();
+    });
+    metricsTimer_.start();
+
+    // Stage timings, top-left over the video; only refreshed while shown
+    profileOverlay_ = new QLabel(ui->videoLabel);
+    profileOverlay_->setAttribute(Qt::WA_TransparentForMouseEvents);
+    profileOverlay_->setStyleSheet(
+        "QLabel {"
+        "  color: #e0e0e0;"
+        "  background: rgba(0, 0, 0, 160);"
+        "  font: 11px 'Consolas', 'DejaVu Sans Mono', monospace;"
+        "  padding: 4px 6px;"
+        "}"
+        );
+    profileOverlay_->move(8, 8);
+    profileOverlay_->hide();
+    profileTimer_.setInterval(500);
+    connect(&profileTimer_, &QTimer::timeout, this, &MainWindow::updateProfileOverlay);
+
     // Keyboard shortcut: press 'S' to save current frame
     saveShortcut_ = new QShortcut(QKeySequence(Qt::Key_S), this);
     connect(saveShortcut_, &QShortcut::activated, this, &MainWindow::saveCurrentFrame);
@@ -107,6 +198,13 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    stopCatalogScan();
+    finishPreopen();
+    decoder_->close();   // join the decoder threads before anything else goes away
+    preopened_->close();
+    rangeCapture_.cancel();
+    saveQueue_.waitForIdle();   // let queued captures reach the disk
+    if (shards_) shards_->finish();
     saveConfig();
     delete ui;
 }
@@ -117,12 +215,11 @@ void MainWindow::on_selectVideoBtn_clicked()
 {
     QString path = QFileDialog::getOpenFileName(this, "Select Video",
                                                 lastVideoPath_.isEmpty() ? QDir::homePath() : QFileInfo(lastVideoPath_).absolutePath(),
-                                                "Videos (*.mp4 *.avi *.mkv *.mov *.m4v *.webm);;All Files (*)");
+                                                QString("Videos (%1);;All Files (*)").arg(DatasetDir::videoNameFilters().join(' ')));
     if (path.isEmpty()) return;
 
     openVideo(path);
     lastVideoPath_ = path;
-    ui->videoPathLabel->setText(path);
     saveConfig();
 }
 
@@ -135,6 +232,10 @@ void MainWindow::on_selectDirBtn_clicked()
     saveDirPath_ = dir;
     ui->saveDirLabel->setText(dir);
 
+    saveDirIndex_.setDirectory(dir);
+    reserver_.setDirectory(dir);
+    hashIndex_.setDirectory(dedupMode_ != "off" ? dir : QString());
+    setupShards();
     recalcNextImageFromDir();
     updateInfoLabels();
     saveConfig();
@@ -142,13 +243,13 @@ void MainWindow::on_selectDirBtn_clicked()
 
 void MainWindow::on_playPauseBtn_clicked()
 {
-    if (!cap_.isOpened()) return;
+    if (!decoder_->isOpened()) return;
     setPlaying(!playing_);
 }
 
 void MainWindow::on_reloadVideoBtn_clicked()
 {
-    if (!cap_.isOpened()) return;
+    if (!decoder_->isOpened()) return;
     // Restart from the beginning and start playing
     setPlaying(false);
     seekTo(0);
@@ -157,22 +258,22 @@ void MainWindow::on_reloadVideoBtn_clicked()
 
 void MainWindow::on_preVideoBtn_clicked()
 {
-    if (!cap_.isOpened()) return;
+    if (!decoder_->isOpened()) return;
     setPlaying(false);
     stepRelative(-1);
 }
 
 void MainWindow::on_nextVideoBtn_clicked()
 {
-    if (!cap_.isOpened()) return;
+    if (!decoder_->isOpened()) return;
     setPlaying(false);
     stepRelative(+1);
 }
 
 void MainWindow::on_timeSlider_sliderMoved(int value)
 {
-    if (!cap_.isOpened()) return;
-    seekTo(value);
+    if (!decoder_->isOpened()) return;
+    scrubTo(value);
 }
 
 void MainWindow::on_timeSlider_sliderPressed()
@@ -183,8 +284,8 @@ void MainWindow::on_timeSlider_sliderPressed()
 
 void MainWindow::on_timeSlider_sliderReleased()
 {
-    if (!cap_.isOpened()) { sliderHeld_ = false; return; }
-    // Finalize position at the released value (cheap, but ensures sync)
+    if (!decoder_->isOpened()) { sliderHeld_ = false; return; }
+    // Finalize position at the released value: exact frame, not the scrub keyframe
     int target = ui->timeSlider->value();
     seekTo(target);
     sliderHeld_ = false;
@@ -194,22 +295,85 @@ void MainWindow::on_timeSlider_sliderReleased()
 
 void MainWindow::tick()
 {
-    if (!cap_.isOpened()) return;
+    if (!decoder_->isOpened()) return;
+    PROFILE_SCOPE(Profiler::Tick);
+
+    // Show the newest frame whose presentation time has come; older due ones are dropped.
+    // Backwards the clock runs down, so "newer" means a lower pts.
+    const double dir = playReverse_ ? -1.0 : 1.0;
+    double now = playClockMs();
+    const int stride = playReverse_ ? reverseDecoder_.stride() : decoder_->stride();
+    const double shownFrameMs = 1000.0 * stride / fps_;   // pts distance of two ring frames
+    auto peek = [this](double &pts) {
+        return playReverse_ ? reverseDecoder_.peekFrontPts(pts) : decoder_->peekFrontPts(pts);
+    };
+    DecodedFrame frame;
+    bool have = false;
+    double pts = 0.0;
+    while (peek(pts))
+    {
+        // Timestamps jumped (seek landed, broken container): restart the clock there
+        const double last = have ? frame.ptsMs : currentPtsMs_;
+        if (dir * (pts - last) < 0.0 || dir * (pts - now) > 1000.0)
+        {
+            if (have) break;
+            restartClock(pts);
+            now = pts;
+        }
+        if (dir * (pts - now) > 0.0) break;
+
+        if (have)
+        {
+            ++droppedFrames_;
+            if (autoCapture_ && frame.sceneChange)
+                autoCapture(frame);   // not shown, but still new content
+        }
+        if (playReverse_) reverseDecoder_.takeFrame(frame);
+        else              decoder_->takeFrame(frame);
+        have = true;
+    }
 
-    cv::Mat frame;
-    if (!cap_.read(frame))
+    if (!have)
     {
-        // End of video => stop
-        setPlaying(false);
+        // End of video (or its start, backwards) => stop
+        if (playReverse_ ? reverseDecoder_.atEnd() : decoder_->atEnd()) { setPlaying(false); return; }
+        if (playReverse_) return;   // previous GOP still decoding
+
+        // Decoder is behind: let it grab() past the frames we would drop anyway
+        const double behindMs = now - currentPtsMs_;
+        if (behindMs > 2.0 * shownFrameMs)
+            decoder_->setSkipBefore(currentFrameIndex_ + static_cast<int>(behindMs * fps_ / 1000.0));
         return;
     }
 
-    currentFrameIndex_ = static_cast<int>(cap_.get(cv::CAP_PROP_POS_FRAMES)) - 1;
-    currentFrameBGR_ = frame.clone();
+    if (dir * (now - frame.ptsMs) > shownFrameMs) ++lateFrames_;
+    ++shownFrames_;
+    presentFrame(frame);
+}
 
-    displayMat(currentFrameBGR_);
-    if (!sliderHeld_)
-        ui->timeSlider->setValue(currentFrameIndex_);
+void MainWindow::onFrameAvailable()
+{
+    // The pre-opened clip fills its ring in the background, nobody shows it yet
+    auto *from = qobject_cast<FrameDecoder*>(sender());
+    if (from && from != decoder_) { from->acknowledge(); return; }
+
+    decoder_->acknowledge();
+    if (!awaitingSeek_) return;   // while playing, tick() pulls the frames itself
+
+    DecodedFrame frame;
+    if (decoder_->takeFrame(frame))
+        presentFrame(frame);
+}
+
+void MainWindow::onIndexReady()
+{
+    if (sender() && sender() != decoder_) return;   // pre-opened clip, read when we switch
+    // The index knows the real frame count (CAP_PROP_FRAME_COUNT is often a guess)
+    const int frames = decoder_->frameCount();
+    if (frames <= 0 || frames == frameCount_) return;
+
+    frameCount_ = frames;
+    ensureSliderRange();
     updateInfoLabels();
 }
 
@@ -265,26 +429,38 @@ void MainWindow::showOverlayGlyph(const QString &glyph)
 
 void MainWindow::togglePlayPause()
 {
-    if (!cap_.isOpened()) return;   // no video loaded → ignore
+    if (!decoder_->isOpened()) return;   // no video loaded → ignore
     setPlaying(!playing_);
 }
 
 void MainWindow::openVideo(const QString &path)
 {
-    if (cap_.isOpened()) cap_.release();
-
-    cap_.open(path.toStdString());
-    if (!cap_.isOpened())
+    if (playing_ && playReverse_) setPlaying(false);   // its capture belongs to the old file
+    awaitingSeek_ = false;
+    currentFrameBGR_.release();
+
+    // Before opening: a broken clip shouldn't block next / previous
+    playlist_.setCurrent(path);
+    if (catalog_.root() != playlist_.dir())
+        scanCatalog(playlist_.dir());
+    ui->videoPathLabel->setText(playlist_.size() > 1
+                                    ? QString("%1  (%2 / %3)").arg(path).arg(playlist_.currentIndex() + 1).arg(playlist_.size())
+                                    : path);
+    updateVideoInfo();
+
+    // Pre-opened in the background => already probed with frame 0 in its ring
+    if (!takePreopened(path) && !decoder_->open(path))
     {
         QMessageBox::warning(this, "Error", "Failed to open video.");
         return;
     }
+    decoder_->setSceneThreshold(autoCapture_ ? sceneThreshold_ : 0.0);
 
-    fps_ = cap_.get(cv::CAP_PROP_FPS);
-    if (fps_ <= 0.0) fps_ = 30.0;
-
-    frameCount_ = static_cast<int>(cap_.get(cv::CAP_PROP_FRAME_COUNT));
+    fps_ = decoder_->fps();
+    frameCount_ = decoder_->frameCount();
     currentFrameIndex_ = 0;
+    markIn_ = markOut_ = -1;
+    sliderOverlay_->update();
 
     ensureSliderRange();
     updateTimerFromFPS();
@@ -292,14 +468,123 @@ void MainWindow::openVideo(const QString &path)
     // Show first frame
     seekTo(0);
     // setPlaying(false);
+
+    preopenNext();
+}
+
+bool MainWindow::switchVideo(int delta)
+{
+    if (playlist_.size() < 2) return false;
+
+    const QString path = playlist_.neighbour(delta);
+    if (path.isEmpty())
+    {
+        statusBar()->showMessage(delta > 0 ? "Last clip in this folder" : "First clip in this folder", 2000);
+        return true;
+    }
+
+    preopenStep_ = delta > 0 ? +1 : -1;
+    openVideo(path);
+    lastVideoPath_ = path;
+    saveConfig();
+    return true;
+}
+
+bool MainWindow::takePreopened(const QString &path)
+{
+    finishPreopen();   // usually long done; otherwise it is the quickest way to the clip anyway
+    if (preopenPath_.isEmpty() || preopenPath_ != QFileInfo(path).absoluteFilePath() || !preopened_->isOpened())
+        return false;
+
+    std::swap(decoder_, preopened_);
+    preopenPath_.clear();
+    reverseDecoder_.setCache(&decoder_->cache());
+    return true;
+}
+
+void MainWindow::preopenNext()
+{
+    finishPreopen();
+
+    // Opening probes the file and starts decoding frame 0; closing joins the old
+    // clip's threads. Both can take a while, so neither happens on the GUI thread.
+    FrameDecoder *d = preopened_;
+    const QString next = playlist_.neighbour(preopenStep_);
+    preopenPath_ = next;
+    preopener_ = std::thread([d, next]() {
+        if (next.isEmpty()) d->close();
+        else d->open(next);
+    });
+}
+
+void MainWindow::finishPreopen()
+{
+    if (preopener_.joinable()) preopener_.join();
+}
+
+void MainWindow::scanCatalog(const QString &dir)
+{
+    stopCatalogScan();
+
+    // The cached part is there right away; the rest is probed in the background,
+    // on half the cores so playback keeps its decoder threads
+    catalog_.load(dir);
+    playlist_.setCatalog(&catalog_);
+    catalogScanner_ = std::thread([this]() {
+        const int threads = std::max(2, static_cast<int>(std::thread::hardware_concurrency()) / 2);
+        if (catalog_.refresh(threads, &catalogCancel_) > 0)
+            QMetaObject::invokeMethod(this, [this]() { updateVideoInfo(); }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::stopCatalogScan()
+{
+    catalogCancel_ = true;
+    if (catalogScanner_.joinable()) catalogScanner_.join();
+    catalogCancel_ = false;
+}
+
+void MainWindow::updateVideoInfo()
+{
+    VideoInfo info;
+    if (!catalog_.find(playlist_.current(), info) || !info.ok)
+    {
+        ui->videoPathLabel->setToolTip(QString());
+        return;
+    }
+
+    const int secs = static_cast<int>(info.durationSec() + 0.5);
+    ui->videoPathLabel->setToolTip(QString("%1x%2 • %3 fps • %4:%5 • %6 frames • %7")
+                                       .arg(info.width).arg(info.height)
+                                       .arg(info.fps, 0, 'f', 2)
+                                       .arg(secs / 60).arg(secs % 60, 2, 10, QChar('0'))
+                                       .arg(info.frameCount)
+                                       .arg(info.codec.isEmpty() ? QString("?") : info.codec));
 }
 
 void MainWindow::updateTimerFromFPS()
 {
-    int intervalMs = static_cast<int>(1000.0 / std::max(1.0, fps_));
+    // Poll at twice the rate frames are shown; the clock decides which frame is due, so
+    // rounding the interval to whole milliseconds no longer causes drift
+    const double shownFps = std::max(1.0, fps_) * speed_ / playStride();
+    int intervalMs = std::max(1, static_cast<int>(500.0 / shownFps));
+    timer_.setTimerType(Qt::PreciseTimer);
     timer_.setInterval(intervalMs);
 }
 
+void MainWindow::restartClock(double ptsMs)
+{
+    clockBasePts_ = ptsMs;
+    clock_.restart();
+}
+
+double MainWindow::playClockMs() const
+{
+    if (!clock_.isValid()) return clockBasePts_;
+    const double rate = playReverse_ ? -speed_ : speed_;
+    return clockBasePts_ + rate * clock_.nsecsElapsed() / 1.0e6;
+}
+
 void MainWindow::ensureSliderRange()
 {
     ui->timeSlider->setMinimum(0);
@@ -310,75 +595,243 @@ void MainWindow::ensureSliderRange()
 
 void MainWindow::seekTo(int frameIndex)
 {
-    if (!cap_.isOpened()) return;
+    if (!decoder_->isOpened()) return;
+    PROFILE_SCOPE(Profiler::Seek);
 
     frameIndex = std::clamp(frameIndex, 0, std::max(0, frameCount_ - 1));
-    cap_.set(cv::CAP_PROP_POS_FRAMES, frameIndex);
 
-    cv::Mat frame;
-    if (cap_.read(frame))
+    // Already prefetched (e.g. stepping forward while paused) => show it right away
+    DecodedFrame frame;
+    if (decoder_->takeFrameAt(frameIndex, frame))
     {
-        currentFrameIndex_ = static_cast<int>(cap_.get(cv::CAP_PROP_POS_FRAMES)) - 1;
-        currentFrameBGR_ = frame.clone();
-        displayMat(currentFrameBGR_);
+        presentFrame(frame);
+        return;
+    }
 
-        // IMPORTANT: don't fight the user while scrubbing
-        if (!sliderHeld_)
-            ui->timeSlider->setValue(currentFrameIndex_);
+    // Decoded earlier (or by the idle filler) => instant, the decoder stays where it is
+    cv::Mat cached;
+    if (decoder_->cache().find(frameIndex, cached))
+    {
+        DecodedFrame hit;
+        hit.index = frameIndex;
+        hit.ptsMs = frameIndex * 1000.0 / fps_;
+        hit.bgr = cached;
+        presentFrame(hit);
+        return;
     }
+
+    // Otherwise let the decoder thread seek; onFrameAvailable() shows the result
+    seekTarget_ = frameIndex;
+    awaitingSeek_ = true;
+    decoder_->seek(frameIndex);
     updateInfoLabels();
 }
 
+void MainWindow::scrubTo(int frameIndex)
+{
+    if (!decoder_->isOpened()) return;
+
+    frameIndex = std::clamp(frameIndex, 0, std::max(0, frameCount_ - 1));
+
+    // Exact frame already decoded => done
+    cv::Mat cached;
+    if (decoder_->cache().find(frameIndex, cached))
+    {
+        DecodedFrame hit;
+        hit.index = frameIndex;
+        hit.ptsMs = frameIndex * 1000.0 / fps_;
+        hit.bgr = cached;
+        presentFrame(hit);
+        return;
+    }
+
+    // Show the nearest cached keyframe right away while the decoder catches up
+    std::shared_ptr<const KeyframeIndex> index = decoder_->keyframeIndex();
+    if (index && index->hasKeyframes())
+    {
+        const int key = index->keyframeAtOrBefore(frameIndex);
+        if (key != currentFrameIndex_ && decoder_->cache().find(key, cached))
+        {
+            DecodedFrame hit;
+            hit.index = key;
+            hit.ptsMs = key * 1000.0 / fps_;
+            hit.bgr = cached;
+            presentFrame(hit);
+        }
+    }
+
+    // Latest wins: this replaces whatever the decoder was still working on.
+    // The exact frame follows in on_timeSlider_sliderReleased().
+    seekTarget_ = frameIndex;
+    awaitingSeek_ = true;
+    decoder_->scrubTo(frameIndex);
+}
+
+void MainWindow::presentFrame(DecodedFrame &frame)
+{
+    awaitingSeek_ = false;
+    currentFrameIndex_ = frame.index;
+    currentPtsMs_ = frame.ptsMs;
+    currentFrameBGR_ = frame.bgr;   // decoder handed it over, no copy needed
+    displayMat(currentFrameBGR_);
+
+    if (autoCapture_ && frame.sceneChange)
+        autoCapture(frame);
+
+    // IMPORTANT: don't fight the user while scrubbing
+    if (!sliderHeld_)
+        ui->timeSlider->setValue(currentFrameIndex_);
+    updateInfoLabels();
+
+    // Paused => let idle cores decode the neighbourhood for the next steps
+    if (!playing_)
+        decoder_->setIdleCenter(currentFrameIndex_);
+}
+
 void MainWindow::stepRelative(int deltaFrames)
 {
-    int target = currentFrameIndex_ + deltaFrames;
+    // Repeated presses before a seek lands should keep counting from its target
+    int target = (awaitingSeek_ ? seekTarget_ : currentFrameIndex_) + deltaFrames;
     seekTo(target);
 }
 
-void MainWindow::setPlaying(bool on)
+void MainWindow::setPlaying(bool on, bool reverse)
 {
     playing_ = on;
-    if (playing_) timer_.start();
-    else          timer_.stop();
+    if (playing_)
+    {
+        playReverse_ = reverse;
+        decoder_->setIdleCenter(-1);
+        droppedFrames_ = lateFrames_ = shownFrames_ = 0;
+        decoder_->resetStats();
+        if (playReverse_)
+        {
+            // Own capture, the forward ring stays where it is for when we turn around
+            reverseDecoder_.setStride(playStride());
+            reverseDecoder_.start(lastVideoPath_, decoder_->keyframeIndex(), currentFrameIndex_ - 1, fps_);
+        }
+        else
+        {
+            // Frames may have come from the cache, make the ring pick up right after them
+            decoder_->continueFrom(currentFrameIndex_ + 1);
+            decoder_->setStride(playStride());
+        }
+        restartClock(currentPtsMs_);
+        timer_.start();
+    }
+    else
+    {
+        timer_.stop();
+        reverseDecoder_.stop();
+        decoder_->setSkipBefore(-1);
+        decoder_->setStride(1);   // stepping and saving want every frame again
+        decoder_->setIdleCenter(currentFrameIndex_);
+    }
 
     ui->playPauseBtn->setToolTip(playing_ ? "Pause" : "Play");
 
     // NEW: visual feedback overlay
-    showOverlayGlyph(playing_ ? "▶" : "⏸");
+    showOverlayGlyph(playing_ ? (playReverse_ ? "◀" : "▶") : "⏸");
 }
 
-void MainWindow::displayMat(const cv::Mat &bgr)
+void MainWindow::shuttle(int direction)
 {
-    if (bgr.empty()) return;
-    QImage img = matToQImage(bgr);
-    // Keep aspect fit inside the QLabel
-    QPixmap pix = QPixmap::fromImage(img).scaled(ui->videoLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    ui->videoLabel->setPixmap(pix);
+    if (!decoder_->isOpened()) return;
+
+    // J / L again in the running direction => faster; otherwise start at 1x that way
+    const bool reverse = direction < 0;
+    if (playing_ && playReverse_ == reverse)
+    {
+        stepSpeed(+1);
+        return;
+    }
+    if (playing_) setPlaying(false);
+    speed_ = 1.0;
+    updateTimerFromFPS();
+    setPlaying(true, reverse);
+}
+
+namespace {
+const double kSpeeds[] = { 0.25, 0.5, 1.0, 2.0, 4.0, 8.0, 16.0 };
 }
 
-QImage MainWindow::matToQImage(const cv::Mat &bgr)
+void MainWindow::setSpeed(double speed)
 {
-    cv::Mat rgb;
-    if (bgr.channels() == 3)
-        cv::cvtColor(bgr, rgb, cv::COLOR_BGR2RGB);
-    else if (bgr.channels() == 4)
-        cv::cvtColor(bgr, rgb, cv::COLOR_BGRA2RGBA);
-    else
-        cv::cvtColor(bgr, rgb, cv::COLOR_GRAY2RGB);
+    // Rebase the clock first so the picture doesn't jump when the rate changes
+    if (playing_) restartClock(playClockMs());
+    speed_ = std::clamp(speed, kSpeeds[0], kSpeeds[std::size(kSpeeds) - 1]);
+
+    if (playing_ && playReverse_)
+    {
+        reverseDecoder_.setStride(playStride());   // takes effect with the next GOP
+    }
+    else if (playing_)
+    {
+        decoder_->setSkipBefore(-1);
+        decoder_->setStride(playStride());
+    }
+    updateTimerFromFPS();
+    if (timer_.isActive()) timer_.start();   // pick up the new interval now
 
-    return QImage(rgb.data, rgb.cols, rgb.rows, static_cast<int>(rgb.step), QImage::Format_RGB888).copy();
+    showOverlayGlyph(QString("%1×").arg(speed_));
+    updateInfoLabels();
+}
+
+void MainWindow::stepSpeed(int direction)
+{
+    const auto begin = std::begin(kSpeeds), end = std::end(kSpeeds);
+    const auto it = std::lower_bound(begin, end, speed_);
+    const int at = static_cast<int>(it - begin);
+    const int next = std::clamp(at + direction, 0, static_cast<int>(std::size(kSpeeds)) - 1);
+    setSpeed(kSpeeds[next]);
+}
+
+int MainWindow::playStride() const
+{
+    // No point converting frames the screen can't show: at 16x a 30 fps clip
+    // runs at 480 fps, a 60 Hz monitor shows every 8th of them
+    const double refresh = screen() ? std::max(24.0, screen()->refreshRate()) : 60.0;
+    const double videoFps = std::max(1.0, fps_) * speed_;
+    return std::max(1, static_cast<int>(std::ceil(videoFps / refresh - 0.01)));
+}
+
+void MainWindow::displayMat(const cv::Mat &bgr)
+{
+    if (bgr.empty()) return;
+    PROFILE_SCOPE(Profiler::Display);
+
+    // Downscale to the label first, then colour convert into the reused buffer.
+    // Keeps aspect fit inside the QLabel; the paint happens in eventFilter().
+    renderer_.render(bgr, ui->videoLabel->size());
+    if (!ui->videoLabel->text().isEmpty())
+        ui->videoLabel->clear();   // drop the "Select a video" hint
+    ui->videoLabel->update();
 }
 
 void MainWindow::updateInfoLabels()
 {
-    ui->frameInfoLabel->setText(QString("Frame: %1 / %2").arg(currentFrameIndex_).arg(frameCount_));
-    ui->nextImageLabel->setText(QString("Next image: %1").arg(nextImageIndex_));
+    ui->frameInfoLabel->setText(QString("Frame: %1 / %2%3%4").arg(currentFrameIndex_).arg(frameCount_)
+                                    .arg(speed_ != 1.0 ? QString(" • %1x").arg(speed_) : QString())
+                                    .arg(autoCapture_ ? QString(" • auto (%1)").arg(autoCaptured_) : QString()));
+    const FramePool::Stats pool = FramePool::shared().stats();
+    ui->frameInfoLabel->setToolTip(QString("Dropped: %1 • Late: %2\nFrame buffers: %3 in use / %4 (%5 MB) • new: %6 of %7")
+                                       .arg(droppedFrames_ + decoder_->skippedFrames())
+                                       .arg(lateFrames_)
+                                       .arg(pool.inUse).arg(pool.buffers)
+                                       .arg(pool.bytes / (1024.0 * 1024.0), 0, 'f', 0)
+                                       .arg(pool.allocated).arg(pool.acquired));
+    const int pending = saveQueue_.pending();
+    if (pending > 0)
+        ui->nextImageLabel->setText(QString("Next image: %1 (saving %2)").arg(nextImageIndex_).arg(pending));
+    else
+        ui->nextImageLabel->setText(QString("Next image: %1").arg(nextImageIndex_));
 }
 
 void MainWindow::saveCurrentFrame()
 {
     if (currentFrameBGR_.empty())
         return;
+    PROFILE_SCOPE(Profiler::Save);
 
     if (saveDirPath_.isEmpty())
     {
@@ -386,33 +839,402 @@ void MainWindow::saveCurrentFrame()
         return;
     }
 
+    // First visit of a huge folder: don't hand out numbers before we know the maximum
+    if (!saveDirIndex_.isReady())
+    {
+        statusBar()->showMessage("Indexing save directory...", 2000);
+        return;
+    }
+
+    // Motion blur: optionally save the sharpest already decoded frame near the play head
+    cv::Mat frame = currentFrameBGR_;
+    QString sharpNote;
+    if (sharpestWindow_ > 0)
+    {
+        int best = currentFrameIndex_;
+        float bestScore = decoder_->sharpnessAt(best);
+        for (int i = currentFrameIndex_ - sharpestWindow_; i <= currentFrameIndex_ + sharpestWindow_; ++i)
+        {
+            if (i < 0 || i == currentFrameIndex_) continue;
+            cv::Mat candidate;
+            const float score = decoder_->sharpnessAt(i);
+            if (score > bestScore && decoder_->cache().find(i, candidate))
+            {
+                best = i;
+                bestScore = score;
+                frame = candidate;
+            }
+        }
+        if (best != currentFrameIndex_)
+            sharpNote = QString(" (sharper frame %1)").arg(best);
+    }
+
+    submitCapture(frame, sharpNote);
+}
+
+void MainWindow::autoCapture(const DecodedFrame &frame)
+{
+    // Same path as S, minus the dialogs: nothing to do without a ready save dir
+    if (saveDirPath_.isEmpty() || !saveDirIndex_.isReady() || frame.bgr.empty())
+        return;
+    if (submitCapture(frame.bgr, QString(" (scene change at frame %1)").arg(frame.index)))
+        ++autoCaptured_;
+}
+
+bool MainWindow::submitCapture(const cv::Mat &frame, const QString &note)
+{
     QDir dir(saveDirPath_);
     if (!dir.exists())
         dir.mkpath(".");
 
-    // Ensure numbering continues from largest numeric filename
-    recalcNextImageFromDir();
+    // Near-duplicate check: the hash is a 9x8 area resize, the lookup a few
+    // hundred popcounts, so this stays far below a frame period
+    quint64 hash = 0;
+    QString duplicateNote;
+    if (dedupMode_ != "off")
+    {
+        hash = ImageHashIndex::dHash(frame);
+        const ImageHashIndex::Match m = hashIndex_.nearest(hash, dedupThreshold_);
+        if (m.number >= 0)
+        {
+            duplicateNote = QString("near-duplicate of %1 (distance %2)")
+                                .arg(DatasetDir::imageFileName(m.number, imageFormat_.extension()))
+                                .arg(m.distance);
+            if (dedupMode_ == "reject")
+            {
+                statusBar()->showMessage("Not saved: " + duplicateNote, 3000);
+                return false;
+            }
+        }
+    }
+
+    // Ensure numbering continues from largest numeric filename.
+    // Never go backwards: queued saves are not on disk yet.
+    // The number itself comes from the folder's shared counter (other instances write here too).
+    const int floor = std::max(nextImageIndex_, saveDirIndex_.largestNumber() + 1);
+    const int index = reserver_.next(floor, kReserveTimeoutMs);
+    if (index < 0)
+    {
+        statusBar()->showMessage("Save directory is locked by another instance - frame not saved, try again", 3000);
+        return false;
+    }
 
-    // Format: image_XXXX.png (zero-padded to 4 digits)
-    QString filename = QString("image_%1.png")
-                           .arg(nextImageIndex_, 4, 10, QLatin1Char('0'));
+    // Format: image_XXXX.<ext> (zero-padded to 4 digits)
+    QString filename = DatasetDir::imageFileName(index, imageFormat_.extension());
+
+    SaveJob job;
+    job.index = index;
+    job.params = imageFormat_.params();
+    job.path = dir.filePath(filename);
+    job.bgr = frame;   // frames are never written to after decode, sharing is safe
+
+    // Disk can't keep up => tell the user instead of stalling the UI
+    if (!saveQueue_.trySubmit(std::move(job)))
+    {
+        statusBar()->showMessage(QString("Save queue full (%1 pending) - frame not saved")
+                                     .arg(saveQueue_.pending()), 2000);
+        reserver_.giveBack(index);
+        return false;
+    }
+
+    // Number is ours now; onFrameSaved() reports once it is written
+    nextImageIndex_ = index + 1;
+    updateInfoLabels();
+    saveConfig();
+
+    if (dedupMode_ != "off")
+        hashIndex_.add(index, hash);   // the very next capture is already checked against it
+    if (!duplicateNote.isEmpty())
+        duplicateNotes_.insert(index, duplicateNote);
+
+    statusBar()->showMessage(QString("Saving: %1%2").arg(filename, note), 3000);
+    return true;
+}
 
-    QString fullPath = dir.filePath(filename);
+void MainWindow::onFrameSaved(int reservedIndex, int index, const QString &path, bool ok)
+{
+    // Hash and note were filed under the reserved number, the image may have ended up elsewhere
+    if (ok)
+    {
+        saveDirIndex_.noteWritten(index);
+        hashIndex_.commit(reservedIndex, index);
+        // Renumbered past a collision: don't advertise a number that is taken now
+        nextImageIndex_ = std::max(nextImageIndex_, index + 1);
+    }
+    else
+    {
+        hashIndex_.remove(reservedIndex);
+    }
+    const QString duplicateNote = duplicateNotes_.take(reservedIndex);
+    updateInfoLabels();
 
-    // Save as PNG
-    bool ok = cv::imwrite(fullPath.toStdString(), currentFrameBGR_);
     if (!ok)
     {
-        QMessageBox::warning(this, "Save failed", "Could not save image.");
+        QMessageBox::warning(this, "Save failed", QString("Could not save image:\n%1").arg(path));
+        return;
+    }
+
+    flashNextImageLabel();
+    if (!duplicateNote.isEmpty())
+        statusBar()->showMessage(QString("Saved: %1 - flagged as %2").arg(QFileInfo(path).fileName(), duplicateNote), 5000);
+    else
+        statusBar()->showMessage(QString("Saved: %1").arg(QFileInfo(path).fileName()), 3000);  // shows for 3 seconds
+}
+
+void MainWindow::setAutoCapture(bool on)
+{
+    if (on && saveDirPath_.isEmpty())
+    {
+        QMessageBox::information(this, "Save directory required", "Please select a save directory first.");
         return;
     }
 
-    ++nextImageIndex_;
+    autoCapture_ = on;
+    autoCaptured_ = 0;
+    decoder_->setSceneThreshold(on ? sceneThreshold_ : 0.0);
+    statusBar()->showMessage(on ? QString("Auto-capture on: saving on scene changes (threshold %1)").arg(sceneThreshold_)
+                                : QString("Auto-capture off"), 3000);
+    updateInfoLabels();
+}
+
+// ================== Profiling ==================
+
+void MainWindow::setProfiling(bool on)
+{
+    Profiler::reset();
+    Profiler::setEnabled(on);
+    profileOverlay_->setVisible(on);
+    if (on)
+    {
+        updateProfileOverlay();
+        profileTimer_.start();
+    }
+    else
+    {
+        profileTimer_.stop();
+    }
+}
+
+void MainWindow::updateProfileOverlay()
+{
+    QStringList lines;
+    lines << QString("%1 %2 %3 %4").arg("stage", -9).arg("n", 7).arg("p50 ms", 8).arg("p99 ms", 8);
+    for (int s = 0; s < Profiler::StageCount; ++s)
+    {
+        const Profiler::Summary sum = Profiler::summary(static_cast<Profiler::Stage>(s));
+        if (sum.count == 0) continue;
+        lines << QString("%1 %2 %3 %4").arg(Profiler::stageName(static_cast<Profiler::Stage>(s)), -9)
+                     .arg(sum.count, 7).arg(sum.p50Ms, 8, 'f', 2).arg(sum.p99Ms, 8, 'f', 2);
+    }
+
+    // Dropped = due but never shown (tick() picked a later one, or the decoder grab()bed past it)
+    const int dropped = droppedFrames_ + decoder_->skippedFrames();
+    const int total = dropped + shownFrames_;
+    lines << QString("dropped %1 of %2 (%3%)").arg(dropped).arg(total)
+                 .arg(total > 0 ? 100.0 * dropped / total : 0.0, 0, 'f', 1);
+
+    profileOverlay_->setText(lines.join('\n'));
+    profileOverlay_->adjustSize();
+}
+
+void MainWindow::exportTrace()
+{
+    if (!Profiler::enabled())
+    {
+        statusBar()->showMessage("Press P to start recording first", 3000);
+        return;
+    }
+
+    const QString path = QFileDialog::getSaveFileName(this, "Export trace",
+                                                      QDir::homePath() + "/vdt-trace.json",
+                                                      "Chrome trace (*.json)");
+    if (path.isEmpty()) return;
+    if (Profiler::writeChromeTrace(path))
+        statusBar()->showMessage("Trace saved (open in chrome://tracing or ui.perfetto.dev): " + path, 5000);
+    else
+        QMessageBox::warning(this, "Error", "Failed to write " + path);
+}
+
+// ================== Range capture ==================
+
+void MainWindow::setMark(bool in)
+{
+    if (!decoder_->isOpened()) return;
+
+    if (in) markIn_ = currentFrameIndex_;
+    else    markOut_ = currentFrameIndex_;
+    if (markIn_ >= 0 && markOut_ >= 0 && markOut_ < markIn_)
+        std::swap(markIn_, markOut_);
+
+    sliderOverlay_->update();
+    statusBar()->showMessage(QString("Range: %1 - %2 (Shift+S to save)")
+                                 .arg(markIn_ >= 0 ? QString::number(markIn_) : QString("?"))
+                                 .arg(markOut_ >= 0 ? QString::number(markOut_) : QString("?")), 4000);
+}
+
+void MainWindow::captureRange()
+{
+    if (!decoder_->isOpened()) return;
+
+    if (saveDirPath_.isEmpty())
+    {
+        QMessageBox::information(this, "Save directory required", "Please select a save directory first.");
+        return;
+    }
+    if (!saveDirIndex_.isReady())
+    {
+        statusBar()->showMessage("Indexing save directory...", 2000);
+        return;
+    }
+    if (rangeCapture_.isRunning())
+    {
+        statusBar()->showMessage("Range capture already running (Esc to cancel)", 2000);
+        return;
+    }
+
+    // A missing mark means "from/to here"
+    int first = markIn_ >= 0 ? markIn_ : currentFrameIndex_;
+    int last = markOut_ >= 0 ? markOut_ : currentFrameIndex_;
+    if (last < first) std::swap(first, last);
+
+    bool ok = false;
+    const int stride = QInputDialog::getInt(this, "Range capture",
+                                            QString("Frames %1 - %2\nSave every Nth frame:").arg(first).arg(last),
+                                            rangeStride_, 1, std::max(1, last - first + 1), 1, &ok);
+    if (!ok) return;
+    rangeStride_ = stride;
+
+    // One block of numbers for the whole range, in frame order
+    const int total = RangeCapture::frameCount(first, last, stride);
+    const int floor = std::max(nextImageIndex_, saveDirIndex_.largestNumber() + 1);
+    const int firstImage = reserver_.reserveBlock(total, floor, kReserveTimeoutMs);
+    if (firstImage < 0)
+    {
+        statusBar()->showMessage("Save directory is locked by another instance - range not saved, try again", 3000);
+        return;
+    }
+
+    RangeCapture::Request req;
+    req.videoPath = lastVideoPath_;
+    req.keyframes = decoder_->keyframeIndex();
+    req.first = first;
+    req.last = last;
+    req.stride = stride;
+    req.firstImage = firstImage;
+    req.outputDir = saveDirPath_;
+    req.extension = imageFormat_.extension();
+    req.params = imageFormat_.params();
+    req.reserver = &reserver_;
+    if (dedupMode_ != "off")
+    {
+        req.hashes = &hashIndex_;
+        req.dedupThreshold = dedupThreshold_;
+        req.rejectDuplicates = dedupMode_ == "reject";
+    }
+    QDir().mkpath(saveDirPath_);
+    rangeCapture_.start(req);
+
+    rangeRejects_ = req.rejectDuplicates;
+    nextImageIndex_ = rangeEndImage_ = firstImage + total;
     updateInfoLabels();
     saveConfig();
+    onRangeProgress(0, total);
+}
 
-    flashNextImageLabel();
-    statusBar()->showMessage(QString("Saved: %1").arg(filename), 3000);  // shows for 4 seconds
+void MainWindow::onRangeProgress(int queued, int total)
+{
+    statusBar()->showMessage(QString("Range capture: %1 / %2 (Esc to cancel)").arg(queued).arg(total));
+    updateInfoLabels();
+}
+
+void MainWindow::onRangeFinished(int queued, int duplicates, int total, int nextImage)
+{
+    // Unused numbers went back to the counter: continue right after the last queued one
+    if (nextImageIndex_ == rangeEndImage_)
+        nextImageIndex_ = nextImage;
+
+    const int skipped = rangeRejects_ ? duplicates : 0;
+    QString msg = queued + skipped == total ? QString("Range capture: %1 frames queued").arg(queued)
+                                            : QString("Range capture stopped: %1 / %2 frames queued").arg(queued).arg(total);
+    if (duplicates > 0)
+        msg += QString(", %1 near-duplicates %2").arg(duplicates).arg(rangeRejects_ ? "skipped" : "flagged");
+    statusBar()->showMessage(msg, 4000);
+    updateInfoLabels();
+    saveConfig();
+}
+
+int MainWindow::sliderX(int frame) const
+{
+    const QSlider *s = ui->timeSlider;
+    QStyleOptionSlider opt;
+    opt.initFrom(s);
+    opt.orientation = s->orientation();
+    opt.minimum = s->minimum();
+    opt.maximum = s->maximum();
+    opt.sliderPosition = opt.sliderValue = s->value();
+    opt.subControls = QStyle::SC_SliderGroove | QStyle::SC_SliderHandle;
+
+    // Same mapping the style uses for the handle centre
+    const QRect groove = s->style()->subControlRect(QStyle::CC_Slider, &opt, QStyle::SC_SliderGroove, s);
+    const QRect handle = s->style()->subControlRect(QStyle::CC_Slider, &opt, QStyle::SC_SliderHandle, s);
+    const int span = groove.width() - handle.width();
+    return groove.x() + handle.width() / 2
+           + QStyle::sliderPositionFromValue(opt.minimum, opt.maximum, frame, span);
+}
+
+void MainWindow::paintSliderOverlay()
+{
+    QPainter p(sliderOverlay_);
+    const int h = sliderOverlay_->height();
+    const QColor accent("#4287f5");
+
+    if (showSharpness_)
+        paintSharpnessCurve(p);
+    if (markIn_ < 0 && markOut_ < 0) return;
+
+    if (markIn_ >= 0 && markOut_ >= 0)
+    {
+        QColor fill = accent;
+        fill.setAlpha(60);
+        p.fillRect(QRect(QPoint(sliderX(markIn_), 0), QPoint(sliderX(markOut_), h - 1)), fill);
+    }
+
+    p.setPen(QPen(accent, 2));
+    for (int mark : { markIn_, markOut_ })
+        if (mark >= 0)
+            p.drawLine(sliderX(mark), 0, sliderX(mark), h);
+}
+
+void MainWindow::paintSharpnessCurve(QPainter &p)
+{
+    const std::vector<float> curve = decoder_->sharpnessCurve();
+    shownMetricsVersion_ = decoder_->metricsVersion();
+    if (curve.empty() || ui->timeSlider->maximum() <= 0) return;
+
+    // One column per pixel: the best frame that maps there, scaled to the best overall
+    const int x0 = sliderX(0);
+    const int x1 = sliderX(ui->timeSlider->maximum());
+    if (x1 <= x0) return;
+    std::vector<float> columns(static_cast<size_t>(x1 - x0 + 1), -1.0f);
+    float top = 0.0f;
+    const double perFrame = double(x1 - x0) / ui->timeSlider->maximum();
+    for (size_t i = 0; i < curve.size(); ++i)
+    {
+        if (curve[i] < 0.0f) continue;
+        const size_t c = std::min(columns.size() - 1, static_cast<size_t>(i * perFrame));
+        columns[c] = std::max(columns[c], curve[i]);
+        top = std::max(top, curve[i]);
+    }
+    if (top <= 0.0f) return;
+
+    const int h = sliderOverlay_->height();
+    QColor color(255, 170, 0, 140);
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        if (columns[c] < 0.0f) continue;
+        const int bar = std::max(1, static_cast<int>(columns[c] / top * (h - 2)));
+        p.fillRect(x0 + static_cast<int>(c), h - bar, 1, bar, color);
+    }
 }
 
 void MainWindow::recalcNextImageFromDir()
@@ -422,33 +1244,28 @@ void MainWindow::recalcNextImageFromDir()
         nextImageIndex_ = 1;
         return;
     }
-    nextImageIndex_ = extractLargestNumberInDir(saveDirPath_) + 1;
+    nextImageIndex_ = saveDirIndex_.largestNumber() + 1;
 }
 
-int MainWindow::extractLargestNumberInDir(const QString &dirPath)
+void MainWindow::setupShards()
 {
-    QDir dir(dirPath);
-    if (!dir.exists()) return 0;
+    // Workers may still be appending to the old shard
+    saveQueue_.waitForIdle();
+    saveQueue_.setShardWriter(nullptr);
+    shards_.reset();
 
-    QStringList filters;
-    filters << "*.jpg" << "*.jpeg" << "*.png" << "*.bmp";
-    QFileInfoList list = dir.entryInfoList(filters, QDir::Files | QDir::NoSymLinks | QDir::Readable);
-
-    int maxNum = 0;
-    QRegularExpression re("(\\d+)");
-    for (const QFileInfo &fi : list)
+    if (shardMB_ > 0 && !saveDirPath_.isEmpty())
     {
-        const QString base = fi.completeBaseName(); // without extension
-        QRegularExpressionMatchIterator it = re.globalMatch(base);
-        while (it.hasNext())
-        {
-            QRegularExpressionMatch m = it.next();
-            bool ok = false;
-            int num = m.captured(1).toInt(&ok);
-            if (ok) maxNum = std::max(maxNum, num);
-        }
+        shards_ = std::make_unique<ShardWriter>(saveDirPath_, qint64(shardMB_) * 1024 * 1024);
+        // Our own shard showing up isn't an external change for the save dir index
+        const QString dir = saveDirPath_;
+        shards_->onClosed = [this, dir](int, int last) {
+            QMetaObject::invokeMethod(this, [this, dir, last]() {
+                if (saveDirIndex_.directory() == dir) saveDirIndex_.noteWritten(last);
+            }, Qt::QueuedConnection);
+        };
+        saveQueue_.setShardWriter(shards_.get());
     }
-    return maxNum;
 }
 
 // ================== Config TXT ==================
@@ -473,6 +1290,18 @@ void MainWindow::loadConfig()
         if (key == "last_video") lastVideoPath_ = val;
         else if (key == "save_dir") saveDirPath_ = val;
         else if (key == "next_image") nextImageIndex_ = val.toInt();
+        else if (key == "prefetch_frames") prefetchFrames_ = std::max(1, val.toInt());
+        else if (key == "cache_mb") cacheMB_ = std::max(0, val.toInt());
+        else if (key == "save_workers") saveWorkers_ = std::max(1, val.toInt());
+        else if (key == "save_queue") saveQueueLimit_ = std::max(1, val.toInt());
+        else if (key == "shard_mb") shardMB_ = std::max(0, val.toInt());
+        else if (key == "dedup" && (val == "off" || val == "flag" || val == "reject")) dedupMode_ = val;
+        else if (key == "dedup_threshold") dedupThreshold_ = std::clamp(val.toInt(), 0, 11);
+        else if (key == "sharpest_window") sharpestWindow_ = std::max(0, val.toInt());
+        else if (key == "sharpness_curve") showSharpness_ = val.toInt() != 0;
+        else if (key == "scene_threshold") sceneThreshold_ = std::clamp(val.toDouble(), 0.01, 1.0);
+        else if (key == "range_stride") rangeStride_ = std::max(1, val.toInt());
+        else if (key == "image_format") ImageFormat::parse(val, imageFormat_);   // keeps the default if invalid
     }
     f.close();
 }
@@ -487,6 +1316,18 @@ void MainWindow::saveConfig() const
     out << "last_video=" << lastVideoPath_ << "\n";
     out << "save_dir="   << saveDirPath_   << "\n";
     out << "next_image=" << nextImageIndex_ << "\n";
+    out << "prefetch_frames=" << prefetchFrames_ << "\n";
+    out << "cache_mb=" << cacheMB_ << "\n";
+    out << "save_workers=" << saveWorkers_ << "\n";
+    out << "save_queue=" << saveQueueLimit_ << "\n";
+    out << "shard_mb=" << shardMB_ << "\n";
+    out << "image_format=" << imageFormat_.toString() << "\n";
+    out << "range_stride=" << rangeStride_ << "\n";
+    out << "scene_threshold=" << sceneThreshold_ << "\n";
+    out << "sharpest_window=" << sharpestWindow_ << "\n";
+    out << "sharpness_curve=" << (showSharpness_ ? 1 : 0) << "\n";
+    out << "dedup=" << dedupMode_ << "\n";
+    out << "dedup_threshold=" << dedupThreshold_ << "\n";
     f.close();
 }
 
@@ -494,6 +1335,25 @@ void MainWindow::saveConfig() const
 
 bool MainWindow::eventFilter(QObject *obj, QEvent *event)
 {
+    // Paint the current frame straight from the renderer's buffer (no QPixmap per frame)
+    if (obj == ui->videoLabel && event->type() == QEvent::Paint && !renderer_.image().isNull())
+    {
+        PROFILE_SCOPE(Profiler::Paint);
+        const QImage &img = renderer_.image();
+        const QRect r = ui->videoLabel->rect();
+        QPainter p(ui->videoLabel);
+        p.drawImage((r.width() - img.width()) / 2, (r.height() - img.height()) / 2, img);
+        return true;
+    }
+
+    if (obj == sliderOverlay_ && event->type() == QEvent::Paint)
+    {
+        paintSliderOverlay();
+        return true;
+    }
+    if (obj == ui->timeSlider && event->type() == QEvent::Resize && sliderOverlay_)
+        sliderOverlay_->setGeometry(ui->timeSlider->rect());
+
     // Handle mouse click on the video label to toggle play/pause
     if (obj == ui->videoLabel && event->type() == QEvent::MouseButtonPress)
     {
@@ -509,8 +1369,8 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event)
         }
     }
 
-    // Handle keys globally (installed on qApp)
-    if (event->type() == QEvent::KeyPress)
+    // Handle keys globally (installed on qApp), but only for this window and never while typing
+    if (event->type() == QEvent::KeyPress && isShortcutTarget(obj))
     {
         auto *ke = static_cast<QKeyEvent*>(event);
 
@@ -520,22 +1380,79 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event)
             return true; // consume
         }
 
+        // P => stage timing overlay, Shift+P => export the recorded trace
+        if (ke->key() == Qt::Key_P) {
+            if (ke->modifiers() & Qt::ShiftModifier) exportTrace();
+            else setProfiling(!Profiler::enabled());
+            return true;
+        }
+
+        // PgUp / PgDn => previous / next clip in the folder
+        if (ke->key() == Qt::Key_PageUp || ke->key() == Qt::Key_PageDown) {
+            if (decoder_->isOpened()) {
+                setPlaying(false);
+                if (!switchVideo(ke->key() == Qt::Key_PageDown ? +1 : -1))
+                    statusBar()->showMessage("Only clip in this folder", 2000);
+            }
+            return true;
+        }
+
+        // J / K / L => shuttle: backwards, stop, forwards (repeat J / L to speed up)
+        if (ke->key() == Qt::Key_J || ke->key() == Qt::Key_L) {
+            shuttle(ke->key() == Qt::Key_J ? -1 : +1);
+            return true;
+        }
+        if (ke->key() == Qt::Key_K) {
+            if (playing_) setPlaying(false);
+            return true;
+        }
+
+        // Shift+S => save the marked range (or I/O marks set so far)
+        if (ke->key() == Qt::Key_S && (ke->modifiers() & Qt::ShiftModifier)) {
+            captureRange();
+            return true;
+        }
+
         // 'S' => save current frame (consume to avoid button triggering)
         if (ke->key() == Qt::Key_S) {
             saveCurrentFrame();
             return true; // consume
         }
 
+        // A => toggle scene-change auto-capture
+        if (ke->key() == Qt::Key_A) {
+            setAutoCapture(!autoCapture_);
+            return true;
+        }
+
+        // ] / [ => faster / slower (0.25x .. 16x)
+        if (ke->key() == Qt::Key_BracketRight || ke->key() == Qt::Key_BracketLeft) {
+            stepSpeed(ke->key() == Qt::Key_BracketRight ? +1 : -1);
+            return true;
+        }
+
+        // I / O => mark range in / out at the current frame
+        if (ke->key() == Qt::Key_I || ke->key() == Qt::Key_O) {
+            setMark(ke->key() == Qt::Key_I);
+            return true;
+        }
+
+        // Esc => stop a running range capture
+        if (ke->key() == Qt::Key_Escape && rangeCapture_.isRunning()) {
+            rangeCapture_.cancel();
+            return true;
+        }
+
         // NEW: Arrow keys step one frame
         if (ke->key() == Qt::Key_Left) {
-            if (cap_.isOpened()) {
+            if (decoder_->isOpened()) {
                 setPlaying(false);      // ensure paused
                 stepRelative(-1);       // go back one frame
             }
             return true;
         }
         if (ke->key() == Qt::Key_Right) {
-            if (cap_.isOpened()) {
+            if (decoder_->isOpened()) {
                 setPlaying(false);      // ensure paused
                 stepRelative(+1);       // forward one frame
             }
@@ -546,6 +1463,20 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event)
     return QMainWindow::eventFilter(obj, event);
 }
 
+bool MainWindow::isShortcutTarget(QObject *obj) const
+{
+    // Key events also pass the filter at QWindow level: judge by the widget they go to
+    const QWidget *w = qobject_cast<QWidget *>(obj);
+    if (!w) w = QApplication::focusWidget();
+    if (!w || w->window() != this) return false;   // file dialogs, input dialogs, other windows
+
+    if (qobject_cast<const QLineEdit *>(w) || qobject_cast<const QAbstractSpinBox *>(w)
+        || qobject_cast<const QTextEdit *>(w) || qobject_cast<const QPlainTextEdit *>(w))
+        return false;
+    const QComboBox *combo = qobject_cast<const QComboBox *>(w);
+    return !combo || !combo->isEditable();
+}
+
 void MainWindow::resizeEvent(QResizeEvent *e)
 {
     QMainWindow::resizeEvent(e);
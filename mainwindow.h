@@ -12,10 +12,30 @@
 #include <QGraphicsOpacityEffect>
 #include <QPropertyAnimation>
 #include <QLabel>
+#include <QElapsedTimer>
+#include <QHash>
+
+#include <atomic>
+#include <memory>
+#include <thread>
 
 #include <opencv2/opencv.hpp>
 
+#include "framedecoder.h"
+#include "framerenderer.h"
+#include "imageformat.h"
+#include "imagehashindex.h"
+#include "imagenumberreserver.h"
+#include "rangecapture.h"
+#include "reversedecoder.h"
+#include "savedirindex.h"
+#include "savequeue.h"
+#include "shardwriter.h"
+#include "videocatalog.h"
+#include "videoplaylist.h"
+
 QT_BEGIN_NAMESPACE
+class QPainter;
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
@@ -47,29 +67,82 @@ private slots:
     void on_timeSlider_sliderPressed();
     void on_timeSlider_sliderReleased();
     void tick();
+    void onFrameAvailable();
+    void onIndexReady();
+    void onFrameSaved(int reservedIndex, int index, const QString &path, bool ok);
+    void onRangeProgress(int queued, int total);
+    void onRangeFinished(int queued, int duplicates, int total, int nextImage);
 
 private:
     Ui::MainWindow *ui;
 
     // Playback
-    QTimer timer_;
-    cv::VideoCapture cap_;
+    QTimer timer_;                  // polls at 2x fps; which frame is due comes from the clock
+    QElapsedTimer clock_;           // monotonic playback clock
+    double clockBasePts_ = 0.0;     // pts shown when clock_ was (re)started
+    double currentPtsMs_ = 0.0;
+    int droppedFrames_ = 0;         // due frames skipped because a later one was due too
+    int lateFrames_ = 0;            // shown more than one frame period after their pts
+    FrameDecoder decoderA_, decoderB_;
+    FrameDecoder *decoder_ = &decoderA_;     // current clip: owns the cv::VideoCapture, decodes on its own thread
+    FrameDecoder *preopened_ = &decoderB_;   // neighbour in the playlist, opened + decoding in the background
+    ReverseDecoder reverseDecoder_; // J: GOPs decoded forward on its own thread, shown backwards
+    bool playReverse_ = false;
+    int prefetchFrames_ = 6;        // ring size ahead of the play head
+    int cacheMB_ = 512;             // decoded-frame cache around the play head
     double fps_ = 30.0;
     int frameCount_ = 0;
     int currentFrameIndex_ = 0;
+    int seekTarget_ = 0;            // where the pending seek will land
+    bool awaitingSeek_ = false;     // a seek was sent to the decoder, show its first frame
     bool playing_ = false;
     bool sliderHeld_ = false;
+    double speed_ = 1.0;            // playback clock rate, [ / ] step through kSpeeds
+
+    // Playlist: the folder of the open clip; PgUp / PgDn switch clips
+    VideoPlaylist playlist_;
+    std::thread preopener_;         // opens/closes preopened_ off the GUI thread
+    QString preopenPath_;           // what preopened_ holds once preopener_ is done
+    int preopenStep_ = +1;          // direction the user last went
+    VideoCatalog catalog_;          // fps / resolution / codec of the folder, cached in AppData
+    std::thread catalogScanner_;    // probes new or changed clips of the folder
+    std::atomic<bool> catalogCancel_{false};
 
     // Saving / state
     QString lastVideoPath_;
     QString saveDirPath_;
-    int nextImageIndex_ = 1;
+    int nextImageIndex_ = 1;        // reserved when the user presses save
+    SaveDirIndex saveDirIndex_;     // largest number on disk without relisting the folder
+    ImageFormat imageFormat_;       // png (OpenCV default level) unless the config says otherwise
+    int shardMB_ = 0;               // > 0: append to tar shards of this size instead of single files
+    std::unique_ptr<ShardWriter> shards_;
+    ImageNumberReserver reserver_;  // shared counter in the save dir, safe across instances
+    SaveQueue saveQueue_;           // PNG encode + write off the GUI thread
+    int saveWorkers_ = 2;
+    int saveQueueLimit_ = 8;        // captures allowed in flight before we refuse
+    RangeCapture rangeCapture_{ saveQueue_ };   // I/O marks + Shift+S: one sequential decode
+    int markIn_ = -1;
+    int markOut_ = -1;
+    int rangeStride_ = 1;
+    int rangeEndImage_ = 0;         // end of the running range's number block
+    bool rangeRejects_ = false;     // its near-duplicates are skipped, not flagged
+
+    // Near-duplicate check at save time
+    ImageHashIndex hashIndex_;      // dHash of every image in the save dir
+    QString dedupMode_ = "off";     // off | flag (save + warn) | reject
+    int dedupThreshold_ = 6;        // max Hamming distance (of 64 bits) that counts as a duplicate
+    QHash<int, QString> duplicateNotes_;   // flagged captures still being written
+    bool autoCapture_ = false;      // A: save whenever the decoder flags a scene change
+    double sceneThreshold_ = 0.15;
+    int autoCaptured_ = 0;
+    int sharpestWindow_ = 0;        // > 0: save the sharpest decoded frame within +-N of the play head
 
     // Shortcuts
     QShortcut *saveShortcut_ = nullptr;
 
     // Frame cache
     cv::Mat currentFrameBGR_;
+    FrameRenderer renderer_;        // label-sized image, painted in eventFilter()
 
     // Config (simple txt)
     QString configPath_;
@@ -88,20 +161,57 @@ private:
     QPropertyAnimation *overlayFade_ = nullptr;
     void showOverlayGlyph(const QString &glyph);  // "▶" or "⏸"
 
+    // drawn over the time slider (in/out marks, sharpness curve)
+    QWidget *sliderOverlay_ = nullptr;
+    QTimer metricsTimer_;
+    quint64 shownMetricsVersion_ = 0;
+    bool showSharpness_ = true;
+    int sliderX(int frame) const;
+    void paintSliderOverlay();
+    void paintSharpnessCurve(QPainter &p);
+
+    // P: per-stage timings over the video (Profiler), Shift+P: save a trace
+    QLabel *profileOverlay_ = nullptr;
+    QTimer profileTimer_;
+    int shownFrames_ = 0;           // presented while playing, for the drop rate
+    void setProfiling(bool on);
+    void updateProfileOverlay();
+    void exportTrace();
+
     // Helpers
+    bool isShortcutTarget(QObject *obj) const;   // key event meant for us, not a dialog or text field
     void togglePlayPause();
     void openVideo(const QString &path);
+    bool switchVideo(int delta);
+    bool takePreopened(const QString &path);
+    void preopenNext();
+    void finishPreopen();
+    void scanCatalog(const QString &dir);
+    void stopCatalogScan();
+    void updateVideoInfo();
     void updateTimerFromFPS();
+    void restartClock(double ptsMs);
+    double playClockMs() const;
     void updateInfoLabels();
     void displayMat(const cv::Mat &bgr);
     void ensureSliderRange();
     void seekTo(int frameIndex);
+    void scrubTo(int frameIndex);
+    void presentFrame(DecodedFrame &frame);
     void stepRelative(int deltaFrames);
-    void setPlaying(bool on);
+    void setPlaying(bool on, bool reverse = false);
+    void shuttle(int direction);
+    void setSpeed(double speed);
+    void stepSpeed(int direction);
+    int playStride() const;
     void recalcNextImageFromDir();
-    static int extractLargestNumberInDir(const QString &dirPath);
+    void setupShards();
     void saveCurrentFrame();
-    static QImage matToQImage(const cv::Mat &bgr);
+    bool submitCapture(const cv::Mat &frame, const QString &note);
+    void autoCapture(const DecodedFrame &frame);
+    void setAutoCapture(bool on);
+    void setMark(bool in);
+    void captureRange();
 };
 
 #endif // MAINWINDOW_H
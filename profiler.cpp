@@ -0,0 +1,170 @@
+#include "profiler.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+std::atomic<bool> Profiler::enabled_{false};
+std::atomic<quint64> Profiler::nextEvent_{0};
+
+namespace {
+
+const std::chrono::steady_clock::time_point kEpoch = std::chrono::steady_clock::now();
+
+// Small stable thread numbers for the trace ("tid")
+int threadNumber()
+{
+    static std::atomic<int> next{1};
+    thread_local const int number = next++;
+    return number;
+}
+
+} // namespace
+
+std::array<Profiler::Histogram, Profiler::StageCount> &Profiler::histograms()
+{
+    static std::array<Histogram, StageCount> h;
+    return h;
+}
+
+std::vector<Profiler::Event> &Profiler::events()
+{
+    // Allocated on first use only, so a never-enabled profiler costs nothing
+    static std::vector<Event> ring(kEvents);
+    return ring;
+}
+
+void Profiler::setEnabled(bool on)
+{
+    if (on) events();   // allocate before any hot path can record
+    enabled_.store(on, std::memory_order_relaxed);
+}
+
+const char *Profiler::stageName(Stage stage)
+{
+    switch (stage)
+    {
+    case Tick:     return "tick";
+    case Seek:     return "seek";
+    case Decode:   return "decode";
+    case Display:  return "display";
+    case ToQImage: return "toQImage";
+    case Paint:    return "paint";
+    case Save:     return "save";
+    case Write:    return "write";
+    default:       return "?";
+    }
+}
+
+qint64 Profiler::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - kEpoch).count();
+}
+
+int Profiler::bucketFor(qint64 us)
+{
+    if (us < 4) return static_cast<int>(std::max<qint64>(0, us));
+    // Highest bit picks the octave, the next two bits the quarter inside it
+    const int msb = 63 - qCountLeadingZeroBits(static_cast<quint64>(us));
+    const int sub = static_cast<int>((us >> (msb - 2)) & 3);
+    return std::min(kBuckets - 1, msb * 4 + sub - 4);
+}
+
+double Profiler::bucketUpperMs(int bucket)
+{
+    if (bucket < 4) return (bucket + 1) / 1000.0;
+    const int msb = (bucket + 4) / 4;
+    const int sub = (bucket + 4) % 4;
+    return double((qint64(4 + sub + 1)) << (msb - 2)) / 1000.0;
+}
+
+void Profiler::record(Stage stage, qint64 startNs, qint64 durationNs)
+{
+    Histogram &h = histograms()[stage];
+    h.buckets[bucketFor(durationNs / 1000)].fetch_add(1, std::memory_order_relaxed);
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    qint64 prev = h.maxNs.load(std::memory_order_relaxed);
+    while (durationNs > prev && !h.maxNs.compare_exchange_weak(prev, durationNs, std::memory_order_relaxed)) {}
+
+    // Overwrite the oldest event; a reader racing a writer may see one torn event, never a crash
+    Event &e = events()[nextEvent_.fetch_add(1, std::memory_order_relaxed) % kEvents];
+    e.startNs.store(startNs, std::memory_order_relaxed);
+    e.durationNs.store(durationNs, std::memory_order_relaxed);
+    e.thread.store(threadNumber(), std::memory_order_relaxed);
+    e.stage.store(stage, std::memory_order_release);
+}
+
+Profiler::Summary Profiler::summary(Stage stage)
+{
+    const Histogram &h = histograms()[stage];
+    std::array<quint32, kBuckets> counts;
+    quint64 total = 0;
+    for (int i = 0; i < kBuckets; ++i)
+        total += counts[i] = h.buckets[i].load(std::memory_order_relaxed);
+
+    Summary s;
+    s.count = total;
+    s.maxMs = h.maxNs.load(std::memory_order_relaxed) / 1.0e6;
+    if (total == 0) return s;
+
+    auto percentile = [&](double p) {
+        const quint64 rank = static_cast<quint64>(p * (total - 1)) + 1;
+        quint64 seen = 0;
+        for (int i = 0; i < kBuckets; ++i)
+            if ((seen += counts[i]) >= rank) return std::min(bucketUpperMs(i), s.maxMs);
+        return s.maxMs;
+    };
+    s.p50Ms = percentile(0.50);
+    s.p99Ms = percentile(0.99);
+    return s;
+}
+
+void Profiler::reset()
+{
+    for (Histogram &h : histograms())
+    {
+        for (auto &b : h.buckets) b.store(0, std::memory_order_relaxed);
+        h.count.store(0, std::memory_order_relaxed);
+        h.maxNs.store(0, std::memory_order_relaxed);
+    }
+    // Nothing recorded => the ring may not even exist yet, don't allocate it just to clear it
+    if (nextEvent_.exchange(0, std::memory_order_relaxed) == 0) return;
+    for (Event &e : events())
+        e.stage.store(-1, std::memory_order_relaxed);
+}
+
+bool Profiler::writeChromeTrace(const QString &path)
+{
+    QJsonArray trace;
+    const quint64 end = nextEvent_.load(std::memory_order_relaxed);
+    const quint64 begin = end > kEvents ? end - kEvents : 0;
+    for (quint64 i = begin; i < end; ++i)
+    {
+        const Event &e = events()[i % kEvents];
+        const int stage = e.stage.load(std::memory_order_acquire);
+        if (stage < 0 || stage >= StageCount) continue;
+
+        QJsonObject o;
+        o["name"] = stageName(static_cast<Stage>(stage));
+        o["cat"] = "vdt";
+        o["ph"] = "X";   // complete event: start + duration
+        o["ts"] = e.startNs.load(std::memory_order_relaxed) / 1000.0;
+        o["dur"] = e.durationNs.load(std::memory_order_relaxed) / 1000.0;
+        o["pid"] = 1;
+        o["tid"] = e.thread.load(std::memory_order_relaxed);
+        trace.append(o);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = trace;
+    root["displayTimeUnit"] = "ms";
+
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) return false;
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Compact);
+    return f.write(json) == json.size();
+}
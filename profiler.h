@@ -0,0 +1,104 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+// Where the time goes when playback stutters. Scoped timers on the hot paths
+// feed per-stage histograms (atomic counters, no locks, any thread) and,
+// optionally, a ring of trace events for chrome://tracing / Perfetto.
+// Disabled (the default) a timer is one relaxed atomic load and a branch.
+class Profiler
+{
+public:
+    enum Stage
+    {
+        Tick,        // MainWindow::tick(), whole playback step
+        Seek,        // MainWindow::seekTo() (GUI side, not the decode)
+        Decode,      // read() on the decoder threads
+        Display,     // displayMat(): scale + colour into the label image
+        ToQImage,    // FrameRenderer::matToQImage()
+        Paint,       // painting the frame onto videoLabel
+        Save,        // saveCurrentFrame() on the GUI thread
+        Write,       // encode + write on the save workers
+        StageCount
+    };
+
+    struct Summary
+    {
+        quint64 count = 0;
+        double p50Ms = 0.0;
+        double p99Ms = 0.0;
+        double maxMs = 0.0;
+    };
+
+    static void setEnabled(bool on);
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    static const char *stageName(Stage stage);
+
+    static void record(Stage stage, qint64 startNs, qint64 durationNs);
+    static Summary summary(Stage stage);
+    static void reset();
+
+    // Nanoseconds on the profiler's clock (steady, process relative)
+    static qint64 nowNs();
+
+    // The last events kept while enabled, as Chrome trace-event JSON
+    static bool writeChromeTrace(const QString &path);
+
+    class Scope
+    {
+    public:
+        explicit Scope(Stage stage)
+            : stage_(stage), start_(Profiler::enabled() ? Profiler::nowNs() : -1) {}
+        ~Scope()
+        {
+            if (start_ >= 0) Profiler::record(stage_, start_, Profiler::nowNs() - start_);
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Stage stage_;
+        qint64 start_;
+    };
+
+private:
+    // Log-linear buckets: 4 per power of two of microseconds (~19% wide)
+    static constexpr int kBuckets = 4 * 32;
+    static int bucketFor(qint64 us);
+    static double bucketUpperMs(int bucket);
+
+    struct Histogram
+    {
+        std::array<std::atomic<quint32>, kBuckets> buckets{};
+        std::atomic<quint64> count{0};
+        std::atomic<qint64> maxNs{0};
+    };
+
+    struct Event
+    {
+        std::atomic<qint64> startNs{0};
+        std::atomic<qint64> durationNs{0};
+        std::atomic<int> stage{-1};
+        std::atomic<int> thread{0};
+    };
+    static constexpr quint64 kEvents = 1 << 16;
+
+    static std::atomic<bool> enabled_;
+    static std::array<Histogram, StageCount> &histograms();
+    static std::vector<Event> &events();
+    static std::atomic<quint64> nextEvent_;
+};
+
+// PROFILE_SCOPE(Profiler::Decode); times the rest of the enclosing block
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(stage) Profiler::Scope PROFILE_CONCAT(profileScope_, __LINE__)(stage)
+
+#endif // PROFILER_H
@@ -0,0 +1,116 @@
+#include "rangecapture.h"
+
+#include "datasetdir.h"
+#include "framepool.h"
+#include "imagehashindex.h"
+#include "imagenumberreserver.h"
+#include "keyframeindex.h"
+#include "savequeue.h"
+
+#include <QDir>
+
+#include <algorithm>
+
+#include <opencv2/videoio.hpp>
+
+RangeCapture::RangeCapture(SaveQueue &queue, QObject *parent)
+    : QObject(parent)
+    , queue_(queue)
+{
+}
+
+RangeCapture::~RangeCapture()
+{
+    cancel();
+}
+
+int RangeCapture::frameCount(int first, int last, int stride)
+{
+    if (last < first) return 0;
+    return (last - first) / std::max(1, stride) + 1;
+}
+
+bool RangeCapture::start(const Request &request)
+{
+    if (running_) return false;
+    if (worker_.joinable()) worker_.join();   // previous run already finished
+
+    cancel_ = false;
+    running_ = true;
+    worker_ = std::thread(&RangeCapture::run, this, request);
+    return true;
+}
+
+void RangeCapture::cancel()
+{
+    cancel_ = true;
+    if (worker_.joinable()) worker_.join();
+}
+
+void RangeCapture::run(Request req)
+{
+    const int stride = std::max(1, req.stride);
+    const int total = frameCount(req.first, req.last, stride);
+    int queued = 0;
+    int duplicates = 0;
+
+    cv::VideoCapture cap(req.videoPath.toStdString());
+    if (cap.isOpened())
+    {
+        // Land on a keyframe so the position is exact, then walk forward
+        int pos = req.keyframes ? req.keyframes->keyframeAtOrBefore(req.first) : req.first;
+        if (pos > 0) cap.set(cv::CAP_PROP_POS_FRAMES, pos);
+
+        const QDir out(req.outputDir);
+        cv::Size geometry;
+        while (pos <= req.last && !cancel_)
+        {
+            const bool wanted = pos >= req.first && (pos - req.first) % stride == 0;
+            if (!wanted)
+            {
+                // Not saved: decode only, skip the colour conversion
+                if (!cap.grab()) break;
+                ++pos;
+                continue;
+            }
+
+            SaveJob job;
+            if (!FramePool::shared().read(cap, job.bgr, geometry)) break;   // recycled once written
+            job.index = req.firstImage + queued;
+
+            // Same gate as MainWindow::submitCapture(); consecutive frames are where duplicates pile up
+            if (req.hashes)
+            {
+                const quint64 hash = ImageHashIndex::dHash(job.bgr);
+                if (req.hashes->nearest(hash, req.dedupThreshold).number >= 0)
+                {
+                    ++duplicates;
+                    if (req.rejectDuplicates)
+                    {
+                        ++pos;
+                        continue;
+                    }
+                }
+                req.hashes->add(job.index, hash);   // committed by whoever handles SaveQueue::saved
+            }
+
+            job.path = out.filePath(DatasetDir::imageFileName(job.index, req.extension));
+            job.params = req.params;
+            queue_.submit(std::move(job));   // waits here if the encoders are behind
+
+            ++queued;
+            ++pos;
+            if (queued % 10 == 0)
+                emit progress(queued, total);
+        }
+    }
+
+    // Unused tail of the block: back to the shared counter unless someone reserved after us
+    int nextImage = req.firstImage + total;
+    if (queued < total && req.reserver
+        && req.reserver->giveBackBlock(req.firstImage + queued, req.firstImage + total))
+        nextImage = req.firstImage + queued;
+
+    running_ = false;
+    emit finished(queued, duplicates, total, nextImage);
+}
@@ -0,0 +1,74 @@
+#ifndef RANGECAPTURE_H
+#define RANGECAPTURE_H
+
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class ImageHashIndex;
+class ImageNumberReserver;
+class KeyframeIndex;
+class SaveQueue;
+
+// Saves every stride-th frame of [first, last] in one sequential pass:
+// one seek to the keyframe before `first`, then grab()/read() forward on a
+// capture of its own, so the player keeps its position and 1000 frames cost
+// decode time instead of 1000 seeks. Frames go to the SaveQueue in order
+// with image numbers reserved by the caller; submit() blocks this thread,
+// not the GUI, when the disk falls behind. Frames pass the same near-duplicate
+// gate as single captures, and numbers left over (cancel, rejected
+// duplicates, early end of the video) go back to the reserver.
+class RangeCapture : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Request
+    {
+        QString videoPath;
+        std::shared_ptr<const KeyframeIndex> keyframes;   // may be null (then a plain seek)
+        int first = 0;
+        int last = 0;
+        int stride = 1;
+        int firstImage = 1;            // image number of `first`, the rest follow
+        QString outputDir;
+        QString extension = "png";
+        std::vector<int> params;       // encoder settings
+        ImageNumberReserver *reserver = nullptr;   // where [firstImage, +frameCount) came from
+        ImageHashIndex *hashes = nullptr;          // near-duplicate check, null = off
+        int dedupThreshold = 6;
+        bool rejectDuplicates = false;             // else saved and counted
+    };
+
+    explicit RangeCapture(SaveQueue &queue, QObject *parent = nullptr);
+    ~RangeCapture() override;
+
+    // Frames a request will save
+    static int frameCount(int first, int last, int stride);
+
+    // False if a capture is already running
+    bool start(const Request &request);
+    void cancel();
+    bool isRunning() const { return running_; }
+
+signals:
+    // Emitted from the capture thread (connect queued)
+    void progress(int queued, int total);
+    // duplicates: near-duplicates seen (skipped if rejected); nextImage: first
+    // number after the ones used, below firstImage + total if the rest went back
+    void finished(int queued, int duplicates, int total, int nextImage);
+
+private:
+    void run(Request request);
+
+    SaveQueue &queue_;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> cancel_{false};
+};
+
+#endif // RANGECAPTURE_H
@@ -0,0 +1,143 @@
+#include "reversedecoder.h"
+
+#include "framecache.h"
+#include "framepool.h"
+#include "keyframeindex.h"
+
+#include <algorithm>
+#include <vector>
+
+ReverseDecoder::~ReverseDecoder()
+{
+    stop();
+}
+
+void ReverseDecoder::start(const QString &path, std::shared_ptr<const KeyframeIndex> index,
+                           int fromFrame, double fps)
+{
+    stop();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ring_.clear();
+        done_ = fromFrame < 0;
+        wanted_ = 0;
+    }
+    if (fromFrame < 0) return;
+
+    cancel_ = false;
+    worker_ = std::thread(&ReverseDecoder::run, this, path, std::move(index), fromFrame, fps);
+}
+
+void ReverseDecoder::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancel_ = true;
+    }
+    cond_.notify_all();
+    if (worker_.joinable()) worker_.join();
+    cancel_ = false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ring_.clear();
+}
+
+bool ReverseDecoder::takeFrame(DecodedFrame &out)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ring_.empty()) return false;
+    out = std::move(ring_.front());
+    ring_.pop_front();
+    cond_.notify_all();
+    return true;
+}
+
+bool ReverseDecoder::peekFrontPts(double &ptsMs) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ring_.empty()) return false;
+    ptsMs = ring_.front().ptsMs;
+    return true;
+}
+
+bool ReverseDecoder::atEnd() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return done_ && ring_.empty();
+}
+
+int ReverseDecoder::chunkFrames(int width, int height) const
+{
+    // Two chunks in flight: the one being shown and the one decoding
+    const size_t frameBytes = size_t(std::max(1, width)) * std::max(1, height) * 3;
+    return static_cast<int>(std::clamp<size_t>(budget_ / 2 / frameBytes, 8, 240));
+}
+
+void ReverseDecoder::run(QString path, std::shared_ptr<const KeyframeIndex> index, int fromFrame, double fps)
+{
+    if (capPath_ != path || !cap_.isOpened())
+    {
+        cap_.release();
+        cap_.open(path.toStdString());
+        capPath_ = path;
+    }
+
+    const int chunk = chunkFrames(static_cast<int>(cap_.get(cv::CAP_PROP_FRAME_WIDTH)),
+                                  static_cast<int>(cap_.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wanted_ = chunk;
+    }
+
+    int pos = fromFrame;   // highest frame still to hand out
+    cv::Size geometry;
+    std::vector<DecodedFrame> frames;
+    while (pos >= 0 && cap_.isOpened() && !cancel_)
+    {
+        // Prefetch exactly one chunk ahead of what is being shown
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [&]() { return cancel_ || static_cast<int>(ring_.size()) < wanted_; });
+        }
+        if (cancel_) break;
+
+        const int lo = std::max(0, pos - chunk + 1);
+        const int key = (index && index->hasKeyframes()) ? index->keyframeAtOrBefore(lo) : lo;
+
+        // Forward through [key, pos]: frames before the chunk and the ones the
+        // stride leaves out are only grab()bed
+        const int stride = stride_;
+        cap_.set(cv::CAP_PROP_POS_FRAMES, key);
+        frames.clear();
+        for (int i = key; i <= pos && !cancel_; ++i)
+        {
+            if (i < lo || (fromFrame - i) % stride != 0)
+            {
+                if (!cap_.grab()) break;
+                continue;
+            }
+            DecodedFrame f;
+            if (!FramePool::shared().read(cap_, f.bgr, geometry)) break;
+            f.index = i;
+            f.ptsMs = i * 1000.0 / fps;   // same clock as cache hits, the container's is unreliable after seeks
+            frames.push_back(std::move(f));
+        }
+        if (cancel_) break;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto it = frames.rbegin(); it != frames.rend(); ++it)
+            {
+                if (cache_) cache_->insert(it->index, it->bgr);
+                ring_.push_back(std::move(*it));
+            }
+        }
+
+        // A short read (frame count was a guess) still hands out what came back
+        pos = lo - 1;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_ = true;
+}
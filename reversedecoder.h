@@ -0,0 +1,75 @@
+#ifndef REVERSEDECODER_H
+#define REVERSEDECODER_H
+
+#include <QString>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <opencv2/videoio.hpp>
+
+#include "framedecoder.h"
+
+class FrameCache;
+class KeyframeIndex;
+
+// Backwards playback without one seek per frame: each GOP is decoded forward
+// once (one seek to its keyframe, then grab()/read()) and handed out last
+// frame first. Runs on its own thread and capture, one chunk ahead, so the
+// previous GOP decodes while the current one is being shown. Long GOPs are
+// split into chunks that fit the memory budget; a chunk further into the GOP
+// then costs a re-decode from the keyframe, but never more than one GOP.
+class ReverseDecoder
+{
+public:
+    ReverseDecoder() = default;
+    ~ReverseDecoder();
+
+    // Hand out fromFrame, fromFrame - stride, ... down to frame 0.
+    // Restarts if already running. index may be null (then plain seeks).
+    void start(const QString &path, std::shared_ptr<const KeyframeIndex> index,
+               int fromFrame, double fps);
+    void stop();
+    bool isRunning() const { return worker_.joinable(); }
+
+    // Decoded frames waiting at most (split over two chunks)
+    void setBudgetBytes(size_t bytes) { budget_ = bytes; }
+
+    // Fast reverse: keep every stride-th frame, only grab() the rest
+    void setStride(int frames) { stride_ = std::max(1, frames); }
+    int stride() const { return stride_; }
+
+    // Frames also land here, so pausing mid-way can step around them
+    void setCache(FrameCache *cache) { cache_ = cache; }
+
+    // Same contract as FrameDecoder, but in descending frame order
+    bool takeFrame(DecodedFrame &out);
+    bool peekFrontPts(double &ptsMs) const;
+    bool atEnd() const;   // frame 0 was handed out (or the file can't be read)
+
+private:
+    void run(QString path, std::shared_ptr<const KeyframeIndex> index, int fromFrame, double fps);
+    int chunkFrames(int width, int height) const;
+
+    cv::VideoCapture cap_;        // worker only; kept open across restarts
+    QString capPath_;
+    std::thread worker_;
+    std::atomic<bool> cancel_{false};
+
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<DecodedFrame> ring_;   // descending frame numbers
+    int wanted_ = 0;                  // producer waits while ring_ holds this many
+    bool done_ = false;
+
+    FrameCache *cache_ = nullptr;
+    size_t budget_ = size_t(256) * 1024 * 1024;
+    std::atomic<int> stride_{1};
+};
+
+#endif // REVERSEDECODER_H
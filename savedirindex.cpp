@@ -0,0 +1,251 @@
+#include "savedirindex.h"
+
+#include "datasetdir.h"
+#include "imagenumberreserver.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextStream>
+
+#include <algorithm>
+
+namespace {
+
+// Reserved numbers probed per look; a bigger backlog is caught up over the next probes
+const int kMaxProbeWindow = 256;
+
+} // namespace
+
+SaveDirIndex::SaveDirIndex(QObject *parent)
+    : QObject(parent)
+{
+    probeTimer_.setSingleShot(true);
+    probeTimer_.setInterval(500);
+    connect(&probeTimer_, &QTimer::timeout, this, &SaveDirIndex::probeForward);
+    // Long enough for another instance to encode and rename its temp file
+    settleTimer_.setSingleShot(true);
+    settleTimer_.setInterval(3000);
+    connect(&settleTimer_, &QTimer::timeout, this, &SaveDirIndex::probeForward);
+    connect(&watcher_, &QFileSystemWatcher::directoryChanged, this, [this]() {
+        if (ready_) probeTimer_.start();
+    });
+}
+
+SaveDirIndex::~SaveDirIndex()
+{
+    stopScan();
+}
+
+void SaveDirIndex::setDirectory(const QString &dirPath)
+{
+    stopScan();
+    probeTimer_.stop();
+    settleTimer_.stop();
+    if (!watcher_.directories().isEmpty())
+        watcher_.removePaths(watcher_.directories());
+
+    dir_ = dirPath;
+    ++scanGen_;
+    max_ = 0;
+    ready_ = false;
+    scanning_ = rescanPending_ = false;
+    ownWrites_ = 0;
+    unexplained_ = false;
+    scannedMTime_ = 0;
+    lastCounter_ = ImageNumberReserver::peekCounter(dir_);
+    if (dir_.isEmpty())
+    {
+        ready_ = true;
+        return;
+    }
+
+    watcher_.addPath(dir_);
+
+    int max = 0;
+    qint64 mtime = 0;
+    if (loadPersisted(max, mtime))
+    {
+        max_ = max;
+        if (mtime != 0 && mtime == dirMTime())
+        {
+            scannedMTime_ = mtime;
+            // Nothing changed since we last looked: no scan at all
+            ready_ = true;
+            emit largestNumberChanged(max_);
+            return;
+        }
+    }
+    startScan();
+}
+
+void SaveDirIndex::noteWritten(int number)
+{
+    ++ownWrites_;
+    if (number > max_)
+    {
+        max_ = number;
+        emit largestNumberChanged(max_);
+    }
+    if (ready_) persist();
+}
+
+// ================== Scanning ==================
+
+void SaveDirIndex::stopScan()
+{
+    cancel_ = true;
+    if (scanner_.joinable()) scanner_.join();
+    cancel_ = false;
+}
+
+void SaveDirIndex::startScan()
+{
+    stopScan();   // join the previous, finished scanner
+    scanning_ = true;
+    const QString dir = dir_;
+    const int gen = scanGen_;
+    scanner_ = std::thread([this, dir, gen]() {
+        const qint64 mtimeBefore = QFileInfo(dir).lastModified().toMSecsSinceEpoch();
+        const int found = DatasetDir::extractLargestNumberInDir(dir);
+        if (cancel_) return;
+
+        // Back on the GUI thread: merge with anything written meanwhile
+        QMetaObject::invokeMethod(this, [this, found, mtimeBefore, gen]() {
+            if (gen != scanGen_) return;
+            scanning_ = false;
+            if (found > max_) max_ = found;
+            ready_ = true;
+            // The listing is complete as of mtimeBefore; later changes make the next start rescan
+            scannedMTime_ = mtimeBefore;
+            persist();
+            emit largestNumberChanged(max_);
+            if (rescanPending_)
+            {
+                rescanPending_ = false;
+                startScan();
+            }
+            else if (dirMTime() != mtimeBefore)
+            {
+                probeForward();   // files may have arrived during the scan
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SaveDirIndex::rescan()
+{
+    if (scanning_) rescanPending_ = true;
+    else startScan();
+}
+
+bool SaveDirIndex::imageExists(int number) const
+{
+    static const QStringList exts = { "png", "jpg", "jpeg", "bmp", "webp", "ppm" };
+    const QDir dir(dir_);
+    for (const QString &ext : exts)
+        if (QFileInfo::exists(dir.filePath(DatasetDir::imageFileName(number, ext))))
+            return true;
+    return false;
+}
+
+void SaveDirIndex::probeForward()
+{
+    // Cheap: only look where new images can be. Numbers below the shared
+    // counter are reserved by us or another instance on the share; past it,
+    // tools without a counter write max+1, max+2, ...
+    const int counter = ImageNumberReserver::peekCounter(dir_);
+    const int windowEnd = std::min(counter, max_ + 1 + kMaxProbeWindow);
+    int max = max_;
+    for (int n = max_ + 1; n < windowEnd; ++n)
+        if (imageExists(n)) max = n;
+    while (imageExists(max + 1))
+        ++max;
+
+    const bool advanced = max > max_;
+    if (advanced)
+    {
+        max_ = max;
+        emit largestNumberChanged(max_);
+    }
+    persist();
+
+    // Expected changes: new images, our writes and their hidden temp files,
+    // and reservations (.vdt_next and its lock, ours or another instance's)
+    const bool counterMoved = counter != lastCounter_;
+    lastCounter_ = counter;
+    const bool ours = ownWrites_ > 0 || (ownWritesPending && ownWritesPending());
+    ownWrites_ = 0;
+    if (advanced || ours || counterMoved)
+    {
+        unexplained_ = false;
+        settleTimer_.stop();
+        return;
+    }
+
+    // Maybe another instance's temp file: its image turns up in the reserved
+    // window once renamed. Still nothing on the second look means something
+    // landed elsewhere in the numbering (another tool, someone else's shard).
+    if (!unexplained_)
+    {
+        unexplained_ = true;
+        settleTimer_.start();
+        return;
+    }
+    unexplained_ = false;
+    rescan();
+}
+
+// ================== Persistence ==================
+
+QString SaveDirIndex::cachePath() const
+{
+    const QString abs = QFileInfo(dir_).absoluteFilePath();
+    const QByteArray key = QCryptographicHash::hash(abs.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+           + QDir::separator() + "dirindex" + QDir::separator() + QString::fromLatin1(key) + ".txt";
+}
+
+qint64 SaveDirIndex::dirMTime() const
+{
+    return QFileInfo(dir_).lastModified().toMSecsSinceEpoch();
+}
+
+bool SaveDirIndex::loadPersisted(int &max, qint64 &mtime) const
+{
+    QFile f(cachePath());
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+
+    bool haveMax = false;
+    QTextStream in(&f);
+    while (!in.atEnd())
+    {
+        const QString line = in.readLine().trimmed();
+        const int eq = line.indexOf('=');
+        if (eq <= 0) continue;
+        const QString key = line.left(eq);
+        const QString val = line.mid(eq + 1);
+        if (key == "max") max = val.toInt(&haveMax);
+        else if (key == "dir_mtime") mtime = val.toLongLong();
+    }
+    return haveMax;
+}
+
+void SaveDirIndex::persist()
+{
+    if (dir_.isEmpty()) return;
+
+    const QString path = cachePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Text)) return;
+
+    QTextStream out(&f);
+    out << "dir=" << dir_ << "\n";
+    out << "max=" << max_ << "\n";
+    // Only a full scan vouches for the whole folder; probes and our own writes don't
+    out << "dir_mtime=" << scannedMTime_ << "\n";
+}
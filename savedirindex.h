@@ -0,0 +1,79 @@
+#ifndef SAVEDIRINDEX_H
+#define SAVEDIRINDEX_H
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+// Largest image number in the save directory, kept up to date without
+// listing the folder on every save:
+//  - persisted in <AppData>/dirindex together with the folder's mtime as of the
+//    last full scan; if the folder didn't change since, no scan at all
+//  - otherwise one full scan on a background thread
+//  - our own writes are reported with noteWritten()
+//  - external changes (QFileSystemWatcher) are picked up by probing names
+//    instead of relisting 200k files: every number the shared .vdt_next
+//    counter has handed out but we haven't seen yet, then max+1, max+2, ...
+//  - counter traffic, our own temp files and other instances' saves are
+//    expected; only a change that is still unexplained after a second look
+//    (image_9000.jpg from another tool) schedules a rescan
+class SaveDirIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SaveDirIndex(QObject *parent = nullptr);
+    ~SaveDirIndex() override;
+
+    void setDirectory(const QString &dirPath);
+    QString directory() const { return dir_; }
+
+    // False while the first full scan is still running
+    bool isReady() const { return ready_; }
+    int largestNumber() const { return max_; }
+
+    // We just wrote image number n
+    void noteWritten(int number);
+
+    // True while this process has saves in flight (their hidden temp files
+    // change the folder too). Called on the GUI thread.
+    std::function<bool()> ownWritesPending;
+
+signals:
+    // Emitted on the GUI thread whenever the known maximum grows or a scan finished
+    void largestNumberChanged(int number);
+
+private:
+    void stopScan();
+    void startScan();
+    void rescan();
+    void probeForward();
+    bool imageExists(int number) const;
+    void persist();
+    bool loadPersisted(int &max, qint64 &mtime) const;
+    QString cachePath() const;
+    qint64 dirMTime() const;
+
+    QString dir_;
+    QFileSystemWatcher watcher_;
+    QTimer probeTimer_;                 // debounces directoryChanged bursts
+    QTimer settleTimer_;                // second look before an unexplained change costs a rescan
+    std::thread scanner_;
+    std::atomic<bool> cancel_{false};
+    std::atomic<bool> ready_{false};
+    std::atomic<int> max_{0};
+    int scanGen_ = 0;                   // results of a scan for a previous folder are ignored
+    bool scanning_ = false;
+    bool rescanPending_ = false;        // changed again while scanning
+    int ownWrites_ = 0;                 // noteWritten() calls since the last probe
+    int lastCounter_ = -1;              // .vdt_next as of the last probe
+    bool unexplained_ = false;          // a probe found nothing to account for the change
+    qint64 scannedMTime_ = 0;           // folder mtime the last full scan saw; 0 = none yet
+};
+
+#endif // SAVEDIRINDEX_H
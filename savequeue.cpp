@@ -0,0 +1,170 @@
+#include "savequeue.h"
+
+#include "datasetdir.h"
+#include "imagenumberreserver.h"
+#include "profiler.h"
+#include "shardwriter.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+
+SaveQueue::SaveQueue(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SaveQueue::~SaveQueue()
+{
+    // Don't lose captures on exit: drain first, then stop
+    waitForIdle();
+    stopWorkers();
+}
+
+void SaveQueue::setWorkerCount(int n)
+{
+    stopWorkers();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = false;
+    }
+    n = std::max(1, n);
+    for (int i = 0; i < n; ++i)
+        workers_.emplace_back(&SaveQueue::run, this);
+}
+
+void SaveQueue::setReserver(ImageNumberReserver *reserver)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    reserver_ = reserver;
+}
+
+void SaveQueue::setShardWriter(ShardWriter *shards)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    shards_ = shards;
+}
+
+void SaveQueue::setMaxPending(int n)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxPending_ = std::max(1, n);
+}
+
+int SaveQueue::maxPending() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return maxPending_;
+}
+
+bool SaveQueue::trySubmit(SaveJob job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (static_cast<int>(jobs_.size()) + inFlight_ >= maxPending_)
+            return false;
+        jobs_.push_back(std::move(job));
+    }
+    cond_.notify_one();
+    return true;
+}
+
+void SaveQueue::submit(SaveJob job)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        spaceCond_.wait(lock, [this]() {
+            return static_cast<int>(jobs_.size()) + inFlight_ < maxPending_;
+        });
+        jobs_.push_back(std::move(job));
+    }
+    cond_.notify_one();
+}
+
+int SaveQueue::pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(jobs_.size()) + inFlight_;
+}
+
+void SaveQueue::waitForIdle()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (workers_.empty()) return;   // nobody would ever drain it
+    idleCond_.wait(lock, [this]() { return jobs_.empty() && inFlight_ == 0; });
+}
+
+void SaveQueue::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    for (std::thread &t : workers_)
+        if (t.joinable()) t.join();
+    workers_.clear();
+}
+
+// ================== Worker ==================
+
+DatasetDir::WriteResult SaveQueue::writeToShard(ShardWriter &shards, const SaveJob &job)
+{
+    // Encode in parallel here, only the append is serialized
+    const QFileInfo fi(job.path);
+    std::vector<uchar> bytes;
+    try {
+        if (!cv::imencode(("." + fi.suffix()).toStdString(), job.bgr, bytes, job.params))
+            return DatasetDir::WriteFailed;
+    } catch (const cv::Exception &) {
+        return DatasetDir::WriteFailed;
+    }
+    // Shard member names come from reserved numbers, nothing to collide with
+    return shards.append(job.index, fi.fileName(), bytes) ? DatasetDir::Written : DatasetDir::WriteFailed;
+}
+
+void SaveQueue::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        cond_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+        if (jobs_.empty()) break;   // stop_ and nothing left
+
+        SaveJob job = std::move(jobs_.front());
+        jobs_.pop_front();
+        const int reservedIndex = job.index;
+        ++inFlight_;
+        ImageNumberReserver *reserver = reserver_;
+        ShardWriter *shards = shards_;
+        lock.unlock();
+
+        DatasetDir::WriteResult result;
+        {
+            PROFILE_SCOPE(Profiler::Write);
+            result = shards ? writeToShard(*shards, job)
+                            : DatasetDir::writeImageExclusive(job.path, job.bgr, job.params);
+            for (int attempt = 0; result == DatasetDir::AlreadyExists && reserver && attempt < 100; ++attempt)
+            {
+                // Somebody got there first: take the next free number instead of overwriting
+                const int index = reserver->next(job.index + 1);
+                if (index < 0) break;
+                const QFileInfo fi(job.path);
+                job.index = index;
+                job.path = fi.dir().filePath(DatasetDir::imageFileName(index, fi.suffix()));
+                result = DatasetDir::writeImageExclusive(job.path, job.bgr, job.params);
+            }
+        }
+        const bool ok = result == DatasetDir::Written;
+        job.bgr.release();
+        emit saved(reservedIndex, job.index, job.path, ok);
+
+        lock.lock();
+        --inFlight_;
+        spaceCond_.notify_one();
+        if (jobs_.empty() && inFlight_ == 0)
+            idleCond_.notify_all();
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef SAVEQUEUE_H
+#define SAVEQUEUE_H
+
+#include <QObject>
+#include <QString>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "datasetdir.h"
+
+class ImageNumberReserver;
+class ShardWriter;
+
+// A frame waiting to be encoded and written
+struct SaveJob
+{
+    int index = 0;        // reserved image number
+    QString path;         // full output path (image_XXXX.<ext> in the save dir)
+    std::vector<int> params;   // encoder settings, see ImageFormat::params()
+    cv::Mat bgr;
+};
+
+// Write-behind queue: encoding + writing runs on worker threads so the GUI
+// never waits on cv::imwrite. Bounded, so a slow disk shows up as a full queue.
+class SaveQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SaveQueue(QObject *parent = nullptr);
+    ~SaveQueue() override;
+
+    // (Re)start with n encoder threads; pending jobs are kept
+    void setWorkerCount(int n);
+    int workerCount() const { return static_cast<int>(workers_.size()); }
+
+    // Where to get a fresh number when the reserved name turns out to be taken
+    // (another instance that doesn't use the shared counter). Not owned.
+    void setReserver(ImageNumberReserver *reserver);
+
+    // Append to tar shards instead of writing single files (nullptr = files). Not owned.
+    void setShardWriter(ShardWriter *shards);
+
+    void setMaxPending(int n);
+    int maxPending() const;
+
+    // Queue a job; false when the queue is full (caller should back off)
+    bool trySubmit(SaveJob job);
+
+    // Queue a job, waiting for room if needed (headless: the disk sets the pace)
+    void submit(SaveJob job);
+
+    // Jobs queued or being written right now
+    int pending() const;
+
+    // Block until everything queued so far hit the disk
+    void waitForIdle();
+
+signals:
+    // Emitted from a worker thread once the write finished. reservedIndex is the
+    // job's number as submitted; index/path are the final ones, they differ if it was renumbered.
+    void saved(int reservedIndex, int index, const QString &path, bool ok);
+
+private:
+    void run();
+    void stopWorkers();
+    static DatasetDir::WriteResult writeToShard(ShardWriter &shards, const SaveJob &job);
+
+    std::vector<std::thread> workers_;
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    std::condition_variable idleCond_;
+    std::condition_variable spaceCond_;
+
+    std::deque<SaveJob> jobs_;
+    int inFlight_ = 0;
+    int maxPending_ = 8;
+    ImageNumberReserver *reserver_ = nullptr;
+    ShardWriter *shards_ = nullptr;
+    bool stop_ = false;
+};
+
+#endif // SAVEQUEUE_H
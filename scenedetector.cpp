@@ -0,0 +1,28 @@
+#include "scenedetector.h"
+
+#include "framemetrics.h"
+
+void SceneDetector::reset()
+{
+    reference_.release();
+}
+
+bool SceneDetector::feed(int frameIndex, const cv::Mat &luma)
+{
+    const cv::Mat thumb = FrameMetrics::differenceThumbnail(luma);
+    if (thumb.empty()) return false;
+
+    if (reference_.empty())
+    {
+        reference_ = thumb.clone();
+        lastTrigger_ = frameIndex;
+        return triggerFirst_;
+    }
+
+    if (frameIndex - lastTrigger_ < minGap_) return false;
+    if (FrameMetrics::difference(reference_, thumb) <= threshold_) return false;
+
+    reference_ = thumb.clone();
+    lastTrigger_ = frameIndex;
+    return true;
+}
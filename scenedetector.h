@@ -0,0 +1,37 @@
+#ifndef SCENEDETECTOR_H
+#define SCENEDETECTOR_H
+
+#include <opencv2/core.hpp>
+
+// Feeds on consecutive decoded frames and fires when the picture moved far
+// enough away from the last frame it fired on (cut, pan, something entering).
+// Comparing against the last trigger instead of the previous frame also
+// catches slow changes. Cheap: a 64 px luma thumbnail difference per frame.
+class SceneDetector
+{
+public:
+    // Mean absolute luma difference, 0..1; 0.1 - 0.2 works for most footage
+    void setThreshold(double t) { threshold_ = t; }
+    double threshold() const { return threshold_; }
+
+    // Never fire twice within this many frames
+    void setMinGap(int frames) { minGap_ = frames; }
+
+    // Fire on the very first frame fed after reset() (headless: keep frame 0)
+    void setTriggerOnFirst(bool on) { triggerFirst_ = on; }
+
+    // Forget the reference (after a seek the next frame is not "new content")
+    void reset();
+
+    // luma: FrameMetrics::luma() of the frame. True = capture this one.
+    bool feed(int frameIndex, const cv::Mat &luma);
+
+private:
+    double threshold_ = 0.15;
+    int minGap_ = 1;
+    bool triggerFirst_ = false;
+    cv::Mat reference_;            // thumbnail of the last trigger
+    int lastTrigger_ = 0;
+};
+
+#endif // SCENEDETECTOR_H
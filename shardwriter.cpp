@@ -0,0 +1,195 @@
+#include "shardwriter.h"
+
+#include <QDateTime>
+#include <QDir>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const int kBlock = 512;
+
+void putOctal(char *field, int width, qint64 value)
+{
+    // width includes the terminating NUL
+    const QByteArray digits = QByteArray::number(value, 8).rightJustified(width - 1, '0');
+    std::memcpy(field, digits.constData(), static_cast<size_t>(width - 1));
+    field[width - 1] = '\0';
+}
+
+QByteArray ustarHeader(const QByteArray &name, qint64 size)
+{
+    QByteArray h(kBlock, '\0');
+    char *p = h.data();
+    std::memcpy(p, name.constData(), static_cast<size_t>(std::min<int>(name.size(), 100)));
+    putOctal(p + 100, 8, 0644);                                     // mode
+    putOctal(p + 108, 8, 0);                                        // uid
+    putOctal(p + 116, 8, 0);                                        // gid
+    putOctal(p + 124, 12, size);
+    putOctal(p + 136, 12, QDateTime::currentSecsSinceEpoch());     // mtime
+    p[156] = '0';                                                   // regular file
+    std::memcpy(p + 257, "ustar", 6);                               // magic + NUL
+    std::memcpy(p + 263, "00", 2);                                  // version
+
+    // Checksum is computed with its own field set to spaces
+    std::memset(p + 148, ' ', 8);
+    unsigned sum = 0;
+    for (int i = 0; i < kBlock; ++i)
+        sum += static_cast<unsigned char>(p[i]);
+    putOctal(p + 148, 7, sum);
+    p[155] = ' ';
+    return h;
+}
+
+bool syncToDisk(QFile &f)
+{
+    if (!f.flush()) return false;
+#ifdef Q_OS_WIN
+    return _commit(f.handle()) == 0;
+#else
+    return ::fsync(f.handle()) == 0;
+#endif
+}
+
+} // namespace
+
+ShardWriter::ShardWriter(const QString &dirPath, qint64 maxShardBytes, int idleCloseMs, int maxOpenMs)
+    : dir_(dirPath)
+    , maxBytes_(std::max<qint64>(maxShardBytes, 4 * kBlock))
+    , idleClose_(std::max(1, idleCloseMs))
+    , maxOpen_(std::max(1, maxOpenMs))
+{
+    closer_ = std::thread(&ShardWriter::runCloser, this);
+}
+
+ShardWriter::~ShardWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    closerCond_.notify_all();
+    closer_.join();
+    finish();
+}
+
+bool ShardWriter::append(int index, const QString &name, const std::vector<uchar> &data)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const QByteArray memberName = name.toUtf8();
+    if (memberName.size() > 100) return false;   // plain ustar names only, ours are short
+
+    const qint64 size = static_cast<qint64>(data.size());
+    const qint64 padded = (size + kBlock - 1) / kBlock * kBlock;
+    const qint64 entryBytes = kBlock + padded;
+
+    // Room for the two end-of-archive blocks too
+    if (file_.isOpen() && file_.size() + entryBytes + 2 * kBlock > maxBytes_)
+        if (!closeShard()) return false;
+    if (!file_.isOpen())
+    {
+        if (!openShard(index)) return false;
+        closerCond_.notify_one();   // it has a deadline to watch now
+    }
+
+    // A failed write must not leave half a member behind: the next one would land after it
+    const qint64 start = file_.pos();
+    auto rollback = [this, start]() {
+        file_.seek(start);
+        file_.resize(start);
+        return false;
+    };
+
+    const qint64 offset = start + kBlock;
+    if (file_.write(ustarHeader(memberName, size)) != kBlock) return rollback();
+    if (file_.write(reinterpret_cast<const char *>(data.data()), size) != size) return rollback();
+    if (padded > size && file_.write(QByteArray(static_cast<int>(padded - size), '\0')) != padded - size)
+        return rollback();
+
+    lastAppend_ = std::chrono::steady_clock::now();
+
+    firstIndex_ = std::min(firstIndex_, index);
+    lastIndex_ = std::max(lastIndex_, index);
+    index_ += memberName + '\t' + QByteArray::number(offset) + '\t' + QByteArray::number(size) + '\n';
+    return true;
+}
+
+bool ShardWriter::finish()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return closeShard();
+}
+
+bool ShardWriter::openShard(int firstIndex)
+{
+    QDir().mkpath(dir_);
+    firstIndex_ = lastIndex_ = firstIndex;
+    index_.clear();
+    openedAt_ = lastAppend_ = std::chrono::steady_clock::now();
+
+    // Hidden + not *.tar until it is complete: loaders and other instances ignore it
+    partialPath_ = QDir(dir_).filePath(QString(".shard_%1.tar.partial").arg(firstIndex, 6, 10, QLatin1Char('0')));
+    file_.setFileName(partialPath_);
+    return file_.open(QIODevice::WriteOnly | QIODevice::Truncate);
+}
+
+bool ShardWriter::closeShard()
+{
+    if (!file_.isOpen()) return true;
+    if (index_.isEmpty())
+    {
+        // Only a rolled-back member: nothing to publish
+        file_.close();
+        return QFile::remove(partialPath_);
+    }
+
+    const QString base = QString("shard_%1-%2")
+                             .arg(firstIndex_, 6, 10, QLatin1Char('0'))
+                             .arg(lastIndex_, 6, 10, QLatin1Char('0'));
+    const QDir dir(dir_);
+
+    // Index first: a visible .tar always has its .idx. Plain write, no sync of
+    // its own: the tar is the data of record (its ustar headers carry the same
+    // offsets), so the tar's fsync below stays the only one per shard.
+    QFile idx(dir.filePath(base + ".idx"));
+    bool ok = idx.open(QIODevice::WriteOnly | QIODevice::Truncate)
+              && idx.write(index_) == index_.size();
+    idx.close();
+
+    ok = file_.write(QByteArray(2 * kBlock, '\0')) == 2 * kBlock && ok;
+    ok = syncToDisk(file_) && ok;   // the one fsync of this shard
+    file_.close();
+
+    const bool published = QFile::rename(partialPath_, dir.filePath(base + ".tar"));
+    ok = published && ok;
+    index_.clear();
+    if (published && onClosed) onClosed(firstIndex_, lastIndex_);
+    return ok;
+}
+
+void ShardWriter::runCloser()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_)
+    {
+        if (!file_.isOpen())
+        {
+            closerCond_.wait(lock);
+            continue;
+        }
+        // Appends move the idle deadline; waking early just means looking again
+        const auto deadline = std::min(lastAppend_ + idleClose_, openedAt_ + maxOpen_);
+        if (std::chrono::steady_clock::now() >= deadline)
+            closeShard();
+        else
+            closerCond_.wait_until(lock, deadline);
+    }
+}
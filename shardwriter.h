@@ -0,0 +1,66 @@
+#ifndef SHARDWRITER_H
+#define SHARDWRITER_H
+
+#include <QFile>
+#include <QString>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Appends encoded images to large tar (ustar) shards instead of writing one
+// small file per image. Any tar reader / webdataset-style loader can stream
+// them. While open a shard is a hidden .partial file; on close it gets one
+// fsync and is renamed to shard_<first>-<last>.tar next to an index
+// shard_<first>-<last>.idx ("name<TAB>offset<TAB>size" per member, offset of
+// the data). Shards are named by reserved image numbers, so instances writing
+// into the same folder never collide. Thread-safe; encode outside, append here.
+// A shard is also closed after idleCloseMs without appends or maxOpenMs in
+// total, so a crash loses at most that much instead of a whole shard.
+class ShardWriter
+{
+public:
+    explicit ShardWriter(const QString &dirPath, qint64 maxShardBytes = qint64(1) << 30,
+                         int idleCloseMs = 10000, int maxOpenMs = 120000);
+    ~ShardWriter();
+
+    // Add one member; a new shard is started when this one would grow past the limit
+    bool append(int index, const QString &name, const std::vector<uchar> &data);
+
+    // Close the current shard (no-op if none is open)
+    bool finish();
+
+    qint64 maxShardBytes() const { return maxBytes_; }
+
+    // Called with the image range of each shard that became visible (any
+    // thread, writer locked). Set before the first append.
+    std::function<void(int first, int last)> onClosed;
+
+private:
+    bool openShard(int firstIndex);
+    bool closeShard();
+    void runCloser();
+
+    std::mutex mutex_;
+    QString dir_;
+    qint64 maxBytes_;
+    std::chrono::milliseconds idleClose_;
+    std::chrono::milliseconds maxOpen_;
+
+    std::thread closer_;               // closes the open shard when idle or old
+    std::condition_variable closerCond_;
+    bool stop_ = false;
+    std::chrono::steady_clock::time_point openedAt_;
+    std::chrono::steady_clock::time_point lastAppend_;
+
+    QFile file_;
+    QString partialPath_;
+    int firstIndex_ = 0;
+    int lastIndex_ = 0;
+    QByteArray index_;         // .idx contents of the open shard
+};
+
+#endif // SHARDWRITER_H
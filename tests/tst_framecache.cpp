@@ -0,0 +1,103 @@
+#include <QtTest>
+
+#include "framecache.h"
+
+// Byte budget and LRU order of the decoded-frame cache
+class TestFrameCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void evictsLeastRecentlyUsed();
+    void accounting();
+    void zeroBudget();
+    void capacity();
+
+private:
+    static cv::Mat frame(int value) { return cv::Mat(100, 100, CV_8UC3, cv::Scalar::all(value)); }
+    static constexpr size_t kFrameBytes = 100 * 100 * 3;
+};
+
+void TestFrameCache::evictsLeastRecentlyUsed()
+{
+    FrameCache cache;
+    cache.setBudgetBytes(3 * kFrameBytes);
+    for (int i = 0; i < 3; ++i)
+        cache.insert(i, frame(i));
+    QVERIFY(cache.contains(0) && cache.contains(1) && cache.contains(2));
+
+    // Touching 0 makes 1 the oldest
+    cv::Mat out;
+    QVERIFY(cache.find(0, out));
+    QCOMPARE(int(out.at<cv::Vec3b>(0, 0)[0]), 0);
+    cache.insert(3, frame(3));
+    QVERIFY(cache.contains(0));
+    QVERIFY(!cache.contains(1));
+    QVERIFY(cache.contains(2) && cache.contains(3));
+    QVERIFY(!cache.find(1, out));
+
+    // contains() doesn't count as a use
+    cache.insert(4, frame(4));
+    QVERIFY(!cache.contains(2));
+    QCOMPARE(cache.bytes(), 3 * kFrameBytes);
+
+    // Shared, not copied
+    QVERIFY(cache.find(4, out));
+    cv::Mat again;
+    QVERIFY(cache.find(4, again));
+    QCOMPARE(out.data, again.data);
+}
+
+void TestFrameCache::accounting()
+{
+    FrameCache cache;
+    cache.setBudgetBytes(10 * kFrameBytes);
+    cache.insert(1, frame(1));
+    cache.insert(2, frame(2));
+    QCOMPARE(cache.bytes(), 2 * kFrameBytes);
+
+    // Same frame again: replaced, not counted twice
+    cache.insert(1, frame(9));
+    QCOMPARE(cache.bytes(), 2 * kFrameBytes);
+    cv::Mat out;
+    QVERIFY(cache.find(1, out));
+    QCOMPARE(int(out.at<cv::Vec3b>(0, 0)[0]), 9);
+
+    cache.insert(3, cv::Mat());   // empty frames are ignored
+    QVERIFY(!cache.contains(3));
+
+    // Lowering the budget evicts right away
+    cache.setBudgetBytes(kFrameBytes);
+    QCOMPARE(cache.bytes(), kFrameBytes);
+    QVERIFY(cache.contains(1));   // most recently used
+    QVERIFY(!cache.contains(2));
+
+    cache.clear();
+    QCOMPARE(cache.bytes(), size_t(0));
+    QVERIFY(!cache.contains(1));
+}
+
+void TestFrameCache::zeroBudget()
+{
+    FrameCache cache;
+    cache.insert(1, frame(1));
+    cache.setBudgetBytes(0);
+    QCOMPARE(cache.bytes(), size_t(0));
+    QVERIFY(!cache.contains(1));
+
+    cache.insert(2, frame(2));
+    QVERIFY(!cache.contains(2));
+    QCOMPARE(cache.bytes(), size_t(0));
+}
+
+void TestFrameCache::capacity()
+{
+    FrameCache cache;
+    QCOMPARE(cache.budgetBytes(), size_t(512) * 1024 * 1024);
+    cache.setBudgetBytes(5 * kFrameBytes + 1);
+    QCOMPARE(cache.capacityFor(frame(0)), 5);
+    QCOMPARE(cache.capacityFor(cv::Mat(100, 100, CV_8UC1)), 15);
+}
+
+QTEST_GUILESS_MAIN(TestFrameCache)
+#include "tst_framecache.moc"
@@ -0,0 +1,55 @@
+#include <QtTest>
+
+#include "imageformat.h"
+
+// Output codec specs ("jpg:90", "png:9", ...) as taken by the GUI and vdt-extract
+class TestImageFormat : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parse_data();
+    void parse();
+};
+
+void TestImageFormat::parse_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("ok");
+    QTest::addColumn<QString>("normalized");
+
+    QTest::newRow("png") << "png" << true << "png";
+    QTest::newRow("png level") << "png:9" << true << "png:9";
+    QTest::newRow("jpeg alias") << "JPEG:90" << true << "jpg:90";
+    QTest::newRow("webp lossless") << "webp:101" << true << "webp:101";
+    QTest::newRow("ppm") << " ppm " << true << "ppm";
+    QTest::newRow("png level too high") << "png:10" << false << "";
+    QTest::newRow("jpg quality 0") << "jpg:0" << false << "";
+    QTest::newRow("quality on ppm") << "ppm:5" << false << "";
+    QTest::newRow("not a number") << "jpg:high" << false << "";
+    QTest::newRow("unknown codec") << "tiff" << false << "";
+    QTest::newRow("two colons") << "jpg:90:1" << false << "";
+}
+
+void TestImageFormat::parse()
+{
+    QFETCH(QString, text);
+    QFETCH(bool, ok);
+    QFETCH(QString, normalized);
+
+    ImageFormat f;
+    f.codec = "bmp";
+    QCOMPARE(ImageFormat::parse(text, f), ok);
+    if (ok)
+    {
+        QCOMPARE(f.toString(), normalized);
+        QCOMPARE(f.params().empty(), f.quality < 0);
+    }
+    else
+    {
+        QCOMPARE(f.codec, QString("bmp"));   // untouched on failure
+    }
+}
+
+QTEST_GUILESS_MAIN(TestImageFormat)
+#include "tst_imageformat.moc"
@@ -0,0 +1,147 @@
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "imagehashindex.h"
+#include "shardwriter.h"
+
+// dHash and the near-duplicate lookup behind it
+class TestImageHash : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void dHash();
+    void lookup();
+    void reconcile();
+
+private:
+    // 288x256 so a 1/8 reduced decode still has 36x32 pixels
+    static cv::Mat gradient(bool up);
+    static cv::Mat columns();
+};
+
+cv::Mat TestImageHash::gradient(bool up)
+{
+    cv::Mat m(256, 288, CV_8UC1);
+    for (int y = 0; y < m.rows; ++y)
+        for (int x = 0; x < m.cols; ++x)
+            m.at<uchar>(y, x) = static_cast<uchar>((up ? x : m.cols - 1 - x) * 255 / (m.cols - 1));
+    return m;
+}
+
+cv::Mat TestImageHash::columns()
+{
+    cv::Mat m(256, 288, CV_8UC1);
+    for (int y = 0; y < m.rows; ++y)
+        for (int x = 0; x < m.cols; ++x)
+            m.at<uchar>(y, x) = static_cast<uchar>((x / 32) % 2 * 200);
+    return m;
+}
+
+void TestImageHash::initTestCase()
+{
+    // The hash cache lives in AppData: keep it out of the real one
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void TestImageHash::dHash()
+{
+    QCOMPARE(ImageHashIndex::dHash(cv::Mat()), quint64(0));
+    QCOMPARE(ImageHashIndex::dHash(gradient(true)), ~quint64(0));
+    QCOMPARE(ImageHashIndex::dHash(gradient(false)), quint64(0));
+    QCOMPARE(ImageHashIndex::dHash(columns()), quint64(0xAAAAAAAAAAAAAAAAull));
+
+    // Brightness and colour don't matter, only the gradients
+    cv::Mat brighter = columns() + 40;
+    QCOMPARE(ImageHashIndex::dHash(brighter), ImageHashIndex::dHash(columns()));
+    cv::Mat bgr;
+    cv::cvtColor(columns(), bgr, cv::COLOR_GRAY2BGR);
+    QCOMPARE(ImageHashIndex::dHash(bgr), ImageHashIndex::dHash(columns()));
+}
+
+void TestImageHash::lookup()
+{
+    QTemporaryDir dir;
+    ImageHashIndex index;
+    index.setDirectory(dir.path());
+    QTRY_VERIFY(index.isReady());
+    QCOMPARE(index.size(), 0);
+    QCOMPARE(index.nearest(0, 11).number, -1);
+
+    const quint64 h = 0x0123456789abcdefull;
+    index.add(1, h);
+    QCOMPARE(index.nearest(h, 0).number, 1);
+    QCOMPARE(index.nearest(h, 0).distance, 0);
+
+    // 3 bits off, one per chunk: only the radius-1 probes find it
+    const quint64 spread = h ^ (quint64(1) << 3) ^ (quint64(1) << 20) ^ (quint64(1) << 40);
+    QCOMPARE(index.nearest(spread, 2).number, -1);
+    QCOMPARE(index.nearest(spread, 6).number, 1);
+    QCOMPARE(index.nearest(spread, 6).distance, 3);
+
+    // 3 bits off in one chunk: the other chunks still match exactly
+    const quint64 packed = h ^ 0x7;
+    QCOMPARE(index.nearest(packed, 3).number, 1);
+
+    // 12 bits off, 3 per chunk: beyond the clamp
+    const quint64 far = h ^ 0x0007000700070007ull;
+    QCOMPARE(index.nearest(far, 64).number, -1);
+
+    // Closest one wins
+    index.add(2, h ^ 0x1);
+    QCOMPARE(index.nearest(h ^ 0x1, 6).number, 2);
+
+    // Dropped when the save failed, re-keyed when it was renumbered
+    index.remove(2);
+    QCOMPARE(index.nearest(h ^ 0x1, 6).number, 1);
+    index.commit(1, 5);
+    QCOMPARE(index.nearest(h, 0).number, 5);
+    index.remove(5);   // on disk already: stays
+    QCOMPARE(index.nearest(h, 0).number, 5);
+}
+
+void TestImageHash::reconcile()
+{
+    QTemporaryDir dir;
+    QDir d(dir.path());
+    QVERIFY(cv::imwrite(d.filePath("image_0001.png").toStdString(), gradient(true)));
+    QVERIFY(cv::imwrite(d.filePath("image_0002.png").toStdString(), gradient(false)));
+    {
+        std::vector<uchar> png;
+        QVERIFY(cv::imencode(".png", columns(), png));
+        ShardWriter shards(dir.path());
+        QVERIFY(shards.append(9, "image_0009.png", png));
+        QVERIFY(shards.finish());
+    }
+
+    {
+        // Nothing cached yet: everything gets hashed, shard members included
+        ImageHashIndex index;
+        index.setDirectory(dir.path());
+        QTRY_VERIFY(index.isReady());
+        QCOMPARE(index.size(), 3);
+        QCOMPARE(index.nearest(~quint64(0), 3).number, 1);
+        QCOMPARE(index.nearest(0, 3).number, 2);
+        QCOMPARE(index.nearest(0xAAAAAAAAAAAAAAAAull, 3).number, 9);
+    }
+
+    // Deleted behind our back: dropped from the cached index on the next load
+    QVERIFY(QFile::remove(d.filePath("image_0002.png")));
+    ImageHashIndex index;
+    index.setDirectory(dir.path());
+    QTRY_VERIFY(index.isReady());
+    QCOMPARE(index.size(), 2);
+    QCOMPARE(index.nearest(0, 3).number, -1);
+    QCOMPARE(index.nearest(0xAAAAAAAAAAAAAAAAull, 3).number, 9);
+}
+
+QTEST_GUILESS_MAIN(TestImageHash)
+#include "tst_imagehash.moc"
@@ -0,0 +1,166 @@
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QLockFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "imagenumberreserver.h"
+
+// Image numbers handed out through the shared .vdt_next counter
+class TestReserver : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void blocks();
+    void seedsFromFloor();
+    void giveBack();
+    void release();
+    void giveBackBlock();
+    void lockTimeout();
+    void peekCounter();
+
+private:
+    static int counter(const QString &dir);
+};
+
+int TestReserver::counter(const QString &dir)
+{
+    QFile f(QDir(dir).filePath(".vdt_next"));
+    if (!f.open(QIODevice::ReadOnly)) return -1;
+    return QString::fromLatin1(f.readAll()).trimmed().toInt();
+}
+
+void TestReserver::blocks()
+{
+    QTemporaryDir dir;
+    ImageNumberReserver a(4), b(4);
+    a.setDirectory(dir.path());
+    b.setDirectory(dir.path());
+
+    // a takes [1, 5), serves from it locally; b gets the next block
+    QCOMPARE(a.next(), 1);
+    QCOMPARE(a.next(), 2);
+    QCOMPARE(counter(dir.path()), 5);
+    QCOMPARE(b.next(), 5);
+    QCOMPARE(counter(dir.path()), 9);
+    QCOMPARE(a.next(), 3);
+    QCOMPARE(a.next(), 4);
+    QCOMPARE(a.next(), 9);   // block used up
+
+    // Local numbers below the floor are skipped
+    QCOMPARE(b.next(7), 7);
+    QCOMPARE(b.next(), 8);
+
+    // Blocks bypass the local block
+    QCOMPARE(a.reserveBlock(10), 13);
+    QCOMPARE(counter(dir.path()), 23);
+    QCOMPARE(a.next(), 10);
+}
+
+void TestReserver::seedsFromFloor()
+{
+    // No counter yet: start at the caller's floor, don't list the folder
+    QTemporaryDir dir;
+    QFile existing(dir.filePath("image_0500.png"));
+    QVERIFY(existing.open(QIODevice::WriteOnly));
+    existing.close();
+
+    ImageNumberReserver r(8);
+    r.setDirectory(dir.path());
+    QCOMPARE(r.next(100), 100);
+    QCOMPARE(counter(dir.path()), 108);
+
+    ImageNumberReserver empty;
+    QCOMPARE(empty.next(), -1);   // no directory
+}
+
+void TestReserver::giveBack()
+{
+    QTemporaryDir dir;
+    ImageNumberReserver r(4);
+    r.setDirectory(dir.path());
+
+    QCOMPARE(r.next(), 1);
+    r.giveBack(1);
+    QCOMPARE(r.next(), 1);
+    QCOMPARE(r.next(), 2);
+    r.giveBack(1);            // not the last one handed out: ignored
+    QCOMPARE(r.next(), 3);
+}
+
+void TestReserver::release()
+{
+    QTemporaryDir dir;
+    {
+        ImageNumberReserver a(16);
+        a.setDirectory(dir.path());
+        QCOMPARE(a.next(), 1);
+        QCOMPARE(a.next(), 2);
+        a.releaseUnused();    // still on top of the counter: 3..16 go back
+        QCOMPARE(counter(dir.path()), 3);
+    }
+
+    ImageNumberReserver a(16), b(16);
+    a.setDirectory(dir.path());
+    b.setDirectory(dir.path());
+    QCOMPARE(a.next(), 3);
+    QCOMPARE(b.next(), 19);
+    a.releaseUnused();        // b reserved after a: a's rest stays a gap
+    QCOMPARE(counter(dir.path()), 35);
+    b.releaseUnused();
+    QCOMPARE(counter(dir.path()), 20);
+}
+
+void TestReserver::giveBackBlock()
+{
+    QTemporaryDir dir;
+    ImageNumberReserver a(4), b(4);
+    a.setDirectory(dir.path());
+    b.setDirectory(dir.path());
+
+    const int first = a.reserveBlock(10);
+    QCOMPARE(first, 1);
+    QVERIFY(a.giveBackBlock(first + 6, first + 10));
+    QCOMPARE(counter(dir.path()), 7);
+    QVERIFY(a.giveBackBlock(5, 5));   // empty tail
+
+    // Somebody reserved after the block: can't undo, the numbers stay unused
+    const int second = a.reserveBlock(10);
+    QCOMPARE(second, 7);
+    QCOMPARE(b.next(), 17);
+    QVERIFY(!a.giveBackBlock(second + 2, second + 10));
+    QCOMPARE(counter(dir.path()), 21);
+}
+
+void TestReserver::lockTimeout()
+{
+    QTemporaryDir dir;
+    ImageNumberReserver r(4);
+    r.setDirectory(dir.path());
+
+    QLockFile other(QDir(dir.path()).filePath(".vdt_next.lock"));
+    QVERIFY(other.lock());
+    QElapsedTimer t;
+    t.start();
+    QCOMPARE(r.next(1, 50), -1);
+    QVERIFY(t.elapsed() < 5000);
+    other.unlock();
+    QCOMPARE(r.next(1, 50), 1);
+}
+
+void TestReserver::peekCounter()
+{
+    QTemporaryDir dir;
+    QCOMPARE(ImageNumberReserver::peekCounter(dir.path()), -1);
+    QCOMPARE(ImageNumberReserver::peekCounter(QString()), -1);
+
+    ImageNumberReserver r(4);
+    r.setDirectory(dir.path());
+    QCOMPARE(r.next(10), 10);
+    QCOMPARE(ImageNumberReserver::peekCounter(dir.path()), 14);
+}
+
+QTEST_GUILESS_MAIN(TestReserver)
+#include "tst_reserver.moc"
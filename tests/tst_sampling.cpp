@@ -0,0 +1,75 @@
+#include <QtTest>
+
+#include "frameextractor.h"
+
+// Which frames vdt-extract keeps: --frames lists and the sampling rules
+class TestSampling : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void frameList_data();
+    void frameList();
+    void samplingRule();
+};
+
+void TestSampling::frameList_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("ok");
+    QTest::addColumn<std::vector<int>>("frames");
+
+    QTest::newRow("single") << "12" << true << std::vector<int>{ 12 };
+    QTest::newRow("list") << "12,40" << true << std::vector<int>{ 12, 40 };
+    QTest::newRow("range") << "100-103" << true << std::vector<int>{ 100, 101, 102, 103 };
+    QTest::newRow("sorted + unique") << "5,1-3,2,5" << true << std::vector<int>{ 1, 2, 3, 5 };
+    QTest::newRow("one-frame range") << "7-7" << true << std::vector<int>{ 7 };
+    QTest::newRow("empty parts") << "1,,2," << true << std::vector<int>{ 1, 2 };
+    QTest::newRow("empty") << "" << true << std::vector<int>{};
+    QTest::newRow("reversed range") << "5-3" << false << std::vector<int>{};
+    QTest::newRow("negative") << "-1" << false << std::vector<int>{};
+    QTest::newRow("open range") << "4-" << false << std::vector<int>{};
+    QTest::newRow("garbage") << "abc" << false << std::vector<int>{};
+}
+
+void TestSampling::frameList()
+{
+    QFETCH(QString, text);
+    QFETCH(bool, ok);
+    QFETCH(std::vector<int>, frames);
+
+    std::vector<int> out;
+    QCOMPARE(SamplingRule::parseFrameList(text, out), ok);
+    if (ok) QCOMPARE(out, frames);
+}
+
+void TestSampling::samplingRule()
+{
+    SamplingRule rule;
+    QVERIFY(rule.isEmpty());
+
+    rule.everyNth = 10;
+    QVERIFY(rule.selects(0, 30.0));
+    QVERIFY(rule.selects(20, 30.0));
+    QVERIFY(!rule.selects(21, 30.0));
+
+    // First frame at or after every full second
+    rule = SamplingRule();
+    rule.everySeconds = 1.0;
+    QVERIFY(rule.selects(0, 30.0));
+    QVERIFY(rule.selects(30, 30.0));
+    QVERIFY(rule.selects(60, 30.0));
+    QVERIFY(!rule.selects(29, 30.0));
+    QVERIFY(!rule.selects(31, 30.0));
+    // 29.97 fps: second 1 starts inside frame 30
+    QVERIFY(rule.selects(30, 29.97));
+    QVERIFY(!rule.selects(29, 29.97));
+
+    rule = SamplingRule();
+    rule.frames = { 3, 8 };
+    QVERIFY(rule.selects(8, 30.0));
+    QVERIFY(!rule.selects(4, 30.0));
+}
+
+QTEST_GUILESS_MAIN(TestSampling)
+#include "tst_sampling.moc"
@@ -0,0 +1,150 @@
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <atomic>
+
+#include "datasetdir.h"
+#include "shardwriter.h"
+
+// Tar shard layout, and shards counting towards the folder's numbering
+class TestShardWriter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void layout();
+    void rollsOver();
+    void closesWhenIdle();
+
+    void imageFileName();
+    void largestNumberInDir();
+
+private:
+    static std::vector<uchar> bytes(int n, uchar fill);
+};
+
+std::vector<uchar> TestShardWriter::bytes(int n, uchar fill)
+{
+    std::vector<uchar> v(static_cast<size_t>(n), fill);
+    if (n > 0) v.back() = 0x7f;   // so a shifted read doesn't compare equal
+    return v;
+}
+
+void TestShardWriter::layout()
+{
+    QTemporaryDir dir;
+    const std::vector<std::vector<uchar>> members = { bytes(1, 'a'), bytes(512, 'b'), bytes(700, 'c') };
+    {
+        ShardWriter w(dir.path());
+        for (int i = 0; i < 3; ++i)
+            QVERIFY(w.append(10 + i, QString("image_%1.png").arg(10 + i, 4, 10, QLatin1Char('0')), members[i]));
+        QVERIFY(w.finish());
+    }
+
+    QDir d(dir.path());
+    QCOMPARE(d.entryList(QDir::Files | QDir::Hidden), QStringList({ "shard_000010-000012.idx", "shard_000010-000012.tar" }));
+
+    QFile tar(d.filePath("shard_000010-000012.tar"));
+    QVERIFY(tar.open(QIODevice::ReadOnly));
+    const QByteArray all = tar.readAll();
+    QCOMPARE(all.size() % 512, 0);
+    QCOMPARE(all.right(1024), QByteArray(1024, '\0'));   // end-of-archive blocks
+
+    QFile idx(d.filePath("shard_000010-000012.idx"));
+    QVERIFY(idx.open(QIODevice::ReadOnly));
+    const QList<QByteArray> lines = idx.readAll().trimmed().split('\n');
+    QCOMPARE(lines.size(), 3);
+
+    qint64 expectedOffset = 512;
+    for (int i = 0; i < 3; ++i)
+    {
+        const QList<QByteArray> f = lines[i].split('\t');
+        QCOMPARE(f.size(), 3);
+        const qint64 offset = f[1].toLongLong();
+        const qint64 size = f[2].toLongLong();
+        QCOMPARE(f[0], QString("image_%1.png").arg(10 + i, 4, 10, QLatin1Char('0')).toUtf8());
+        QCOMPARE(offset, expectedOffset);
+        QCOMPARE(size, qint64(members[i].size()));
+        QCOMPARE(all.mid(offset, size), QByteArray(reinterpret_cast<const char *>(members[i].data()), int(size)));
+
+        // ustar header right before the data
+        const QByteArray h = all.mid(offset - 512, 512);
+        QCOMPARE(h.left(f[0].size()), f[0]);
+        QCOMPARE(h.mid(124, 11).toLongLong(nullptr, 8), size);
+        QCOMPARE(h.mid(257, 5), QByteArray("ustar"));
+        QCOMPARE(h.at(156), '0');
+        unsigned sum = 0;
+        for (int k = 0; k < 512; ++k)
+            sum += (k >= 148 && k < 156) ? unsigned(' ') : static_cast<unsigned char>(h.at(k));
+        QCOMPARE(h.mid(148, 6).toUInt(nullptr, 8), sum);
+
+        expectedOffset += 512 + (size + 511) / 512 * 512;
+    }
+}
+
+void TestShardWriter::rollsOver()
+{
+    // Room for one 1 KB member (+ header + end blocks) per 4 KB shard
+    QTemporaryDir dir;
+    {
+        ShardWriter w(dir.path(), 4 * 512);
+        QVERIFY(w.append(1, "image_0001.png", bytes(1024, 'x')));
+        QVERIFY(w.append(2, "image_0002.png", bytes(1024, 'y')));
+    }   // destructor closes the last one
+    const QStringList shards = QDir(dir.path()).entryList({ "*.tar" }, QDir::Files);
+    QCOMPARE(shards, QStringList({ "shard_000001-000001.tar", "shard_000002-000002.tar" }));
+    QVERIFY(QDir(dir.path()).entryList({ "*.partial" }, QDir::Files | QDir::Hidden).isEmpty());
+}
+
+void TestShardWriter::closesWhenIdle()
+{
+    QTemporaryDir dir;
+    std::atomic<int> closedLast{ 0 };
+    ShardWriter w(dir.path(), qint64(1) << 30, 200);
+    w.onClosed = [&closedLast](int, int last) { closedLast = last; };
+
+    QVERIFY(w.append(5, "image_0005.png", bytes(100, 'z')));
+    QVERIFY(w.append(6, "image_0006.png", bytes(100, 'z')));
+    // Published without finish(): a crash now can't take these with it
+    QTRY_COMPARE_WITH_TIMEOUT(closedLast.load(), 6, 5000);
+    QVERIFY(QFile::exists(QDir(dir.path()).filePath("shard_000005-000006.tar")));
+
+    // The next append starts a new shard
+    QVERIFY(w.append(7, "image_0007.png", bytes(100, 'z')));
+    QVERIFY(w.finish());
+    QVERIFY(QFile::exists(QDir(dir.path()).filePath("shard_000007-000007.tar")));
+}
+
+void TestShardWriter::imageFileName()
+{
+    QCOMPARE(DatasetDir::imageFileName(42), QString("image_0042.png"));
+    QCOMPARE(DatasetDir::imageFileName(7, "jpg"), QString("image_0007.jpg"));
+    QCOMPARE(DatasetDir::imageFileName(123456, "webp"), QString("image_123456.webp"));
+}
+
+void TestShardWriter::largestNumberInDir()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QCOMPARE(DatasetDir::extractLargestNumberInDir(dir.path()), 0);
+
+    auto touch = [&dir](const QString &name) {
+        QFile f(dir.filePath(name));
+        QVERIFY(f.open(QIODevice::WriteOnly));
+    };
+    touch("image_0003.png");
+    touch("image_0041.jpg");
+    touch("notes_9999.txt");                             // not an image
+#ifndef Q_OS_WIN
+    touch(DatasetDir::tempFileName("image_5000", "png")); // still being written (dot files are hidden)
+#endif
+    QCOMPARE(DatasetDir::extractLargestNumberInDir(dir.path()), 41);
+
+    touch("shard_000050-000077.tar");                    // a shard counts with its last number
+    QCOMPARE(DatasetDir::extractLargestNumberInDir(dir.path()), 77);
+}
+
+QTEST_GUILESS_MAIN(TestShardWriter)
+#include "tst_shardwriter.moc"
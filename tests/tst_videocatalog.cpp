@@ -0,0 +1,171 @@
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <opencv2/videoio.hpp>
+
+#include "videocatalog.h"
+
+// The per-folder video catalog: cache key, incremental re-scan, cache file
+class TestVideoCatalog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void rescanProbesOnlyChanges();
+    void cacheRoundTrip();
+    void corruptCache();
+    void probeReadable();
+
+private:
+    static void writeJunk(const QString &path, int bytes);
+};
+
+void TestVideoCatalog::writeJunk(const QString &path, int bytes)
+{
+    // Not a video: probed as unreadable, which is all the cache logic needs
+    QFile f(path);
+    QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    f.write(QByteArray(bytes, 'x'));
+}
+
+void TestVideoCatalog::initTestCase()
+{
+    // The catalog cache lives in AppData: keep it out of the real one
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void TestVideoCatalog::rescanProbesOnlyChanges()
+{
+    QTemporaryDir dir;
+    QDir d(dir.path());
+    writeJunk(d.filePath("clip_10.mp4"), 100);
+    writeJunk(d.filePath("clip_2.mp4"), 100);
+    writeJunk(d.filePath("notes.txt"), 10);
+
+    VideoCatalog catalog;
+    QVERIFY(!catalog.load(dir.path()));   // nothing cached yet
+    QCOMPARE(catalog.refresh(2), 2);
+    QCOMPARE(catalog.size(), 2);
+
+    // Natural order, absolute paths
+    const std::vector<VideoInfo> videos = catalog.videos();
+    QCOMPARE(QFileInfo(videos[0].path).fileName(), QString("clip_2.mp4"));
+    QCOMPARE(QFileInfo(videos[1].path).fileName(), QString("clip_10.mp4"));
+    QVERIFY(QFileInfo(videos[0].path).isAbsolute());
+    QVERIFY(catalog.isUnreadable(d.filePath("clip_2.mp4")));
+    QVERIFY(!catalog.isUnreadable(d.filePath("clip_99.mp4")));   // unknown isn't bad
+    QVERIFY(catalog.readablePaths().isEmpty());
+
+    // Nothing changed: stat only
+    QCOMPARE(catalog.refresh(2), 0);
+
+    // A changed size is a new file as far as the cache key goes
+    writeJunk(d.filePath("clip_2.mp4"), 200);
+    QCOMPARE(catalog.refresh(2), 1);
+    VideoInfo info;
+    QVERIFY(catalog.find(d.filePath("clip_2.mp4"), info));
+    QCOMPARE(info.size, qint64(200));
+
+    // Vanished files are forgotten, without probing anything
+    QVERIFY(QFile::remove(d.filePath("clip_10.mp4")));
+    QCOMPARE(catalog.refresh(2), 0);
+    QCOMPARE(catalog.size(), 1);
+    QVERIFY(!catalog.find(d.filePath("clip_10.mp4"), info));
+}
+
+void TestVideoCatalog::cacheRoundTrip()
+{
+    QTemporaryDir dir;
+    QDir d(dir.path());
+    writeJunk(d.filePath("a.mp4"), 100);
+    writeJunk(d.filePath("b.mkv"), 300);
+
+    std::vector<VideoInfo> before;
+    {
+        VideoCatalog catalog;
+        catalog.load(dir.path());
+        QCOMPARE(catalog.refresh(2), 2);
+        before = catalog.videos();
+    }
+    QVERIFY(QFile::exists(VideoCatalog::cachePathFor(dir.path(), false)));
+    QVERIFY(VideoCatalog::cachePathFor(dir.path(), false) != VideoCatalog::cachePathFor(dir.path(), true));
+
+    // A new instance gets everything from the cache file ...
+    VideoCatalog catalog;
+    QVERIFY(catalog.load(dir.path()));
+    const std::vector<VideoInfo> after = catalog.videos();
+    QCOMPARE(after.size(), before.size());
+    for (size_t i = 0; i < after.size(); ++i)
+    {
+        QCOMPARE(after[i].path, before[i].path);
+        QCOMPARE(after[i].size, before[i].size);
+        QCOMPARE(after[i].mtimeMs, before[i].mtimeMs);
+        QCOMPARE(after[i].ok, before[i].ok);
+        QCOMPARE(after[i].codec, before[i].codec);
+    }
+    // ... and has nothing to probe
+    QCOMPARE(catalog.refresh(2), 0);
+
+    // The recursive listing of the same root is a different catalog
+    VideoCatalog recursive;
+    QVERIFY(!recursive.load(dir.path(), true));
+}
+
+void TestVideoCatalog::corruptCache()
+{
+    QTemporaryDir dir;
+    const QString path = VideoCatalog::cachePathFor(dir.path(), false);
+    QVERIFY(QDir().mkpath(QFileInfo(path).absolutePath()));
+
+    // Right header, absurd record count, no records
+    {
+        QFile f(path);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        QDataStream out(&f);
+        out << quint32(0x56444354) << quint32(1) << quint32(0xffffffffu);
+    }
+    VideoCatalog catalog;
+    QVERIFY(!catalog.load(dir.path()));
+    QCOMPARE(catalog.size(), 0);
+
+    // Garbage
+    {
+        QFile f(path);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        f.write(QByteArray(37, '\x7f'));
+    }
+    QVERIFY(!catalog.load(dir.path()));
+    QCOMPARE(catalog.size(), 0);
+}
+
+void TestVideoCatalog::probeReadable()
+{
+    QTemporaryDir dir;
+    const QString path = QDir(dir.path()).filePath("clip.avi");
+    {
+        cv::VideoWriter writer(path.toStdString(), cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 10.0, cv::Size(64, 48));
+        if (!writer.isOpened()) QSKIP("no MJPG writer in this OpenCV build");
+        const cv::Mat frame(48, 64, CV_8UC3, cv::Scalar(0, 128, 255));
+        for (int i = 0; i < 5; ++i)
+            writer.write(frame);
+    }
+
+    const VideoInfo info = VideoCatalog::probe(path);
+    QVERIFY(info.ok);
+    QCOMPARE(info.width, 64);
+    QCOMPARE(info.height, 48);
+    QCOMPARE(info.frameCount, 5);
+    QCOMPARE(info.fps, 10.0);
+    QCOMPARE(info.codec, QString("MJPG"));
+    QCOMPARE(info.size, QFileInfo(path).size());
+}
+
+QTEST_GUILESS_MAIN(TestVideoCatalog)
+#include "tst_videocatalog.moc"
@@ -0,0 +1,259 @@
+#include "videocatalog.h"
+
+#include "datasetdir.h"
+#include "keyframeindex.h"
+#include "workstealingpool.h"
+
+#include <QCollator>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <thread>
+
+#include <opencv2/videoio.hpp>
+
+namespace {
+const quint32 kMagic = 0x56444354;   // "VDCT"
+const quint32 kVersion = 1;
+}
+
+QString VideoCatalog::cachePathFor(const QString &rootDir, bool recursive)
+{
+    const QString abs = QFileInfo(rootDir).absoluteFilePath() + (recursive ? "|r" : "");
+    const QByteArray key = QCryptographicHash::hash(abs.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+           + QDir::separator() + "catalog" + QDir::separator() + QString::fromLatin1(key) + ".vdc";
+}
+
+QString VideoCatalog::root() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return root_;
+}
+
+bool VideoCatalog::recursive() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return recursive_;
+}
+
+std::vector<VideoInfo> VideoCatalog::videos() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return videos_;
+}
+
+QStringList VideoCatalog::readablePaths() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    QStringList out;
+    for (const VideoInfo &v : videos_)
+        if (v.ok) out << v.path;
+    return out;
+}
+
+int VideoCatalog::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(videos_.size());
+}
+
+bool VideoCatalog::find(const QString &path, VideoInfo &out) const
+{
+    const QString abs = QFileInfo(path).absoluteFilePath();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = byPath_.constFind(abs);
+    if (it == byPath_.constEnd()) return false;
+    out = videos_[static_cast<size_t>(it.value())];
+    return true;
+}
+
+bool VideoCatalog::isUnreadable(const QString &path) const
+{
+    VideoInfo info;
+    return find(path, info) && !info.ok;
+}
+
+void VideoCatalog::setVideosLocked(std::vector<VideoInfo> videos)
+{
+    videos_ = std::move(videos);
+    byPath_.clear();
+    byPath_.reserve(static_cast<int>(videos_.size()));
+    for (size_t i = 0; i < videos_.size(); ++i)
+        byPath_.insert(videos_[i].path, static_cast<int>(i));
+}
+
+// ================== Cache ==================
+
+bool VideoCatalog::load(const QString &rootDir, bool recursive)
+{
+    const QString root = QFileInfo(rootDir).absoluteFilePath();
+    std::vector<VideoInfo> videos;
+
+    QFile f(cachePathFor(root, recursive));
+    bool cached = false;
+    if (f.open(QIODevice::ReadOnly))
+    {
+        QDataStream in(&f);
+        quint32 magic = 0, version = 0, n = 0;
+        in >> magic >> version >> n;
+        // n comes from the file: no reserve on its word, a bad count just runs
+        // into the status check below
+        cached = magic == kMagic && version == kVersion;
+        for (quint32 i = 0; cached && i < n; ++i)
+        {
+            VideoInfo v;
+            qint32 frames = 0, width = 0, height = 0;
+            in >> v.path >> v.size >> v.mtimeMs >> v.ok >> v.fps >> frames >> width >> height >> v.codec;
+            if (in.status() != QDataStream::Ok) { cached = false; break; }   // torn file: probe again
+            v.frameCount = frames;
+            v.width = width;
+            v.height = height;
+            videos.push_back(std::move(v));
+        }
+        if (!cached) videos.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    root_ = root;
+    recursive_ = recursive;
+    setVideosLocked(std::move(videos));
+    return cached;
+}
+
+bool VideoCatalog::save(const std::vector<VideoInfo> &videos) const
+{
+    const QString path = cachePathFor(root_, recursive_);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&f);
+    out << kMagic << kVersion << quint32(videos.size());
+    for (const VideoInfo &v : videos)
+        out << v.path << v.size << v.mtimeMs << v.ok << v.fps
+            << qint32(v.frameCount) << qint32(v.width) << qint32(v.height) << v.codec;
+    return out.status() == QDataStream::Ok && f.commit();
+}
+
+// ================== Probing ==================
+
+VideoInfo VideoCatalog::probe(const QString &path)
+{
+    const QFileInfo fi(path);
+    VideoInfo v;
+    v.path = fi.absoluteFilePath();
+    v.size = fi.size();
+    v.mtimeMs = fi.lastModified().toMSecsSinceEpoch();
+
+    cv::VideoCapture cap(path.toStdString());
+    if (!cap.isOpened()) return v;
+
+    v.ok = true;
+    v.fps = cap.get(cv::CAP_PROP_FPS);
+    v.frameCount = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_COUNT));
+    v.width = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
+    v.height = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+
+    const int fourcc = static_cast<int>(cap.get(cv::CAP_PROP_FOURCC));
+    for (int i = 0; i < 4; ++i)
+    {
+        const char c = static_cast<char>((fourcc >> (8 * i)) & 0xff);
+        if (c > ' ') v.codec += QChar(c);
+    }
+
+    // The GUI may have walked the file already: that count is exact
+    const KeyframeIndex index = KeyframeIndex::load(path);
+    if (index.isValid()) v.frameCount = index.frameCount();
+    return v;
+}
+
+int VideoCatalog::refresh(int threads, const std::atomic<bool> *cancel,
+                          const std::function<void(int done, int total)> &progress)
+{
+    QString root;
+    bool recursive = false;
+    QHash<QString, VideoInfo> known;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        root = root_;
+        recursive = recursive_;
+        known.reserve(static_cast<int>(videos_.size()));
+        for (const VideoInfo &v : videos_)
+            known.insert(v.path, v);
+    }
+    if (root.isEmpty()) return 0;
+
+    // Stat the tree (directory entries only); unchanged files keep their entry
+    std::vector<VideoInfo> videos;
+    std::vector<size_t> toProbe;
+    QDirIterator it(root, DatasetDir::videoNameFilters(), QDir::Files | QDir::Readable,
+                    recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext())
+    {
+        it.next();
+        const QFileInfo fi = it.fileInfo();
+        const QString path = fi.absoluteFilePath();
+        const qint64 size = fi.size();
+        const qint64 mtime = fi.lastModified().toMSecsSinceEpoch();
+
+        auto cached = known.constFind(path);
+        if (cached != known.constEnd() && cached->size == size && cached->mtimeMs == mtime)
+        {
+            videos.push_back(*cached);
+            continue;
+        }
+        VideoInfo v;
+        v.path = path;
+        toProbe.push_back(videos.size());
+        videos.push_back(std::move(v));
+    }
+    if (cancel && *cancel) return 0;
+    const bool removed = videos.size() - toProbe.size() != static_cast<size_t>(known.size());
+
+    // Opening a file is mostly waiting on the disk and the demuxer: plenty of threads pay off
+    if (!toProbe.empty())
+    {
+        std::atomic<int> done{0};
+        std::mutex progressMutex;
+        const int total = static_cast<int>(toProbe.size());
+        WorkStealingPool pool(threads > 0 ? threads : 2 * static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+        for (size_t slot : toProbe)
+        {
+            pool.submit([&, slot]() {
+                if (cancel && *cancel) return;
+                videos[slot] = probe(videos[slot].path);
+                const int n = ++done;
+                if (progress)
+                {
+                    std::lock_guard<std::mutex> lock(progressMutex);
+                    progress(n, total);
+                }
+            });
+        }
+        pool.waitIdle();
+        if (cancel && *cancel) return 0;
+    }
+
+    QCollator collator;
+    collator.setNumericMode(true);
+    std::sort(videos.begin(), videos.end(), [&collator](const VideoInfo &a, const VideoInfo &b) {
+        return collator.compare(a.path, b.path) < 0;
+    });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (root_ != root || recursive_ != recursive) return 0;   // load() moved on meanwhile
+    if (!toProbe.empty() || removed)
+        save(videos);
+    setVideosLocked(std::move(videos));
+    return static_cast<int>(toProbe.size());
+}
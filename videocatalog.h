@@ -0,0 +1,76 @@
+#ifndef VIDEOCATALOG_H
+#define VIDEOCATALOG_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// What a video is, without opening it again
+struct VideoInfo
+{
+    QString path;            // absolute
+    qint64 size = 0;         // file size + mtime: the cache key besides the path
+    qint64 mtimeMs = 0;
+    bool ok = false;         // cv::VideoCapture could open it
+    double fps = 0.0;
+    int frameCount = 0;      // from the keyframe index when there is one, else the container's guess
+    int width = 0;
+    int height = 0;
+    QString codec;           // FOURCC, e.g. "h264", "avc1", "MJPG"
+
+    double durationSec() const { return fps > 0.0 ? frameCount / fps : 0.0; }
+};
+
+// Metadata of every video under a directory. Probing opens each file with
+// cv::VideoCapture on a thread pool; results are cached per root in
+// <AppData>/catalog/<sha1>.vdc keyed by path + size + mtime, so a re-scan
+// only stats the tree and probes what changed. Thread-safe: a background
+// refresh() can run while other threads read.
+class VideoCatalog
+{
+public:
+    // Point at a tree and read its cache (one file, no probing).
+    // False if there is no usable cache yet.
+    bool load(const QString &rootDir, bool recursive = false);
+
+    // List the tree, probe new or changed files on `threads` threads (0 = two
+    // per core, it's mostly I/O), forget vanished ones, save. Returns the number
+    // of files probed.
+    int refresh(int threads = 0, const std::atomic<bool> *cancel = nullptr,
+                const std::function<void(int done, int total)> &progress = {});
+
+    QString root() const;
+    bool recursive() const;
+
+    // Natural order (clip_2 before clip_10)
+    std::vector<VideoInfo> videos() const;
+    QStringList readablePaths() const;
+    int size() const;
+
+    bool find(const QString &path, VideoInfo &out) const;
+    // Probed and couldn't be opened (unknown files are not "bad")
+    bool isUnreadable(const QString &path) const;
+
+    // Cache file for a root: <AppData>/catalog/<sha1 of root + mode>.vdc
+    static QString cachePathFor(const QString &rootDir, bool recursive);
+
+    // Open one file and read its properties (what refresh() does per file)
+    static VideoInfo probe(const QString &path);
+
+private:
+    bool save(const std::vector<VideoInfo> &videos) const;
+    void setVideosLocked(std::vector<VideoInfo> videos);
+
+    mutable std::mutex mutex_;
+    QString root_;
+    bool recursive_ = false;
+    std::vector<VideoInfo> videos_;
+    QHash<QString, int> byPath_;   // absolute path -> videos_ index
+};
+
+#endif // VIDEOCATALOG_H
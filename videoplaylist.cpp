@@ -0,0 +1,46 @@
+#include "videoplaylist.h"
+
+#include "datasetdir.h"
+#include "videocatalog.h"
+
+#include <QFileInfo>
+
+void VideoPlaylist::setCurrent(const QString &path)
+{
+    const QFileInfo fi(path);
+    const QString dir = fi.absolutePath();
+    const bool moved = dir != dir_;
+    if (moved)
+    {
+        dir_ = dir;
+        refresh();
+    }
+
+    current_ = files_.indexOf(fi.absoluteFilePath());
+    if (current_ < 0 && !moved)
+    {
+        // Added to the folder since we listed it
+        refresh();
+        current_ = files_.indexOf(fi.absoluteFilePath());
+    }
+}
+
+QString VideoPlaylist::neighbour(int delta) const
+{
+    if (current_ < 0 || delta == 0) return QString();
+
+    const int step = delta > 0 ? 1 : -1;
+    for (int i = current_ + delta; i >= 0 && i < files_.size(); i += step)
+        if (!catalog_ || !catalog_->isUnreadable(files_.at(i)))
+            return files_.at(i);
+    return QString();
+}
+
+void VideoPlaylist::refresh()
+{
+    const QString current = at(current_);
+    files_.clear();
+    for (const QString &f : DatasetDir::listVideos(dir_))
+        files_ << QFileInfo(f).absoluteFilePath();
+    current_ = current.isEmpty() ? -1 : files_.indexOf(current);
+}
@@ -0,0 +1,39 @@
+#ifndef VIDEOPLAYLIST_H
+#define VIDEOPLAYLIST_H
+
+#include <QString>
+#include <QStringList>
+
+class VideoCatalog;
+
+// The clips of one folder in natural order (clip_2 before clip_10) and which
+// one is open. Opening a file from another folder switches the folder.
+class VideoPlaylist
+{
+public:
+    // List the folder of `path` (unless it's the current one) and point at path
+    void setCurrent(const QString &path);
+
+    // Clips the catalog probed as unreadable are skipped by neighbour()
+    void setCatalog(const VideoCatalog *catalog) { catalog_ = catalog; }
+
+    QString dir() const { return dir_; }
+    int size() const { return files_.size(); }
+    int currentIndex() const { return current_; }
+    QString current() const { return at(current_); }
+    QString at(int index) const { return index >= 0 && index < files_.size() ? files_.at(index) : QString(); }
+
+    // Next readable clip `delta` steps away from the current one, empty past either end
+    QString neighbour(int delta) const;
+
+    // Re-list the folder (clips added or removed meanwhile)
+    void refresh();
+
+private:
+    const VideoCatalog *catalog_ = nullptr;
+    QString dir_;
+    QStringList files_;
+    int current_ = -1;
+};
+
+#endif // VIDEOPLAYLIST_H
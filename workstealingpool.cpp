@@ -0,0 +1,148 @@
+#include "workstealingpool.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+// Which pool / deque the current thread works for (-1 = not a pool thread)
+thread_local const WorkStealingPool *tlsPool = nullptr;
+thread_local int tlsIndex = -1;
+}
+
+WorkStealingPool::WorkStealingPool(int threads)
+{
+    if (threads <= 0) threads = QThread::idealThreadCount();
+    threads = std::max(1, threads);
+
+    for (int i = 0; i < threads; ++i)
+        queues_.push_back(std::make_unique<Queue>());
+    for (int i = 0; i < threads; ++i)
+        threads_.emplace_back(&WorkStealingPool::run, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    waitIdle();
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stop_ = true;
+    }
+    sleepCond_.notify_all();
+    for (std::thread &t : threads_)
+        if (t.joinable()) t.join();
+}
+
+void WorkStealingPool::submit(std::function<void()> task, Priority priority)
+{
+    // Pool threads push to their own deque (cache-warm, LIFO); others spread round-robin
+    const int n = static_cast<int>(queues_.size());
+    const int target = (tlsPool == this) ? tlsIndex : static_cast<int>(nextQueue_++ % n);
+
+    ++pending_;
+    {
+        Queue &q = *queues_[target];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        (priority == High ? q.high : q.normal).push_back(std::move(task));
+        ++queued_;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);   // pairs with the wait in run()
+    }
+    sleepCond_.notify_one();
+}
+
+bool WorkStealingPool::pop(int self, bool highOnly, std::function<void()> &task)
+{
+    const int n = static_cast<int>(queues_.size());
+    const int start = self >= 0 ? self : 0;
+
+    // High first everywhere, then Normal: own deque from the back, victims from the front
+    for (int pass = 0; pass < (highOnly ? 1 : 2); ++pass)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            const int idx = (start + i) % n;
+            Queue &q = *queues_[idx];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            std::deque<std::function<void()>> &d = (pass == 0) ? q.high : q.normal;
+            if (d.empty()) continue;
+
+            if (idx == self)
+            {
+                task = std::move(d.back());
+                d.pop_back();
+            }
+            else
+            {
+                task = std::move(d.front());
+                d.pop_front();
+            }
+            --queued_;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::execute(std::function<void()> &task)
+{
+    try {
+        task();
+    } catch (...) {
+        // A failing task must not take the pool (or the pending count) down
+    }
+    task = nullptr;
+
+    if (--pending_ == 0)
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        idleCond_.notify_all();
+    }
+}
+
+bool WorkStealingPool::helpOne()
+{
+    std::function<void()> task;
+    const int self = (tlsPool == this) ? tlsIndex : -1;
+    if (!pop(self, true, task)) return false;
+    execute(task);
+    return true;
+}
+
+void WorkStealingPool::waitIdle()
+{
+    const int self = (tlsPool == this) ? tlsIndex : -1;
+    while (pending_ > 0)
+    {
+        std::function<void()> task;
+        if (pop(self, false, task))
+        {
+            execute(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        idleCond_.wait_for(lock, std::chrono::milliseconds(5), [this]() { return pending_ == 0; });
+    }
+}
+
+void WorkStealingPool::run(int self)
+{
+    tlsPool = this;
+    tlsIndex = self;
+
+    while (true)
+    {
+        std::function<void()> task;
+        if (pop(self, false, task))
+        {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepCond_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+        if (stop_ && queued_ == 0) break;
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads, one task deque per thread. A thread works its own
+// deque from the back and steals from the front of the others when empty.
+// Two priorities: High tasks (downstream pipeline stages, e.g. encoding) are
+// always drained before Normal ones, so a pipeline empties before it refills.
+class WorkStealingPool
+{
+public:
+    enum Priority { Normal, High };
+
+    explicit WorkStealingPool(int threads = 0);   // 0 = one per core
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    int threadCount() const { return static_cast<int>(threads_.size()); }
+
+    void submit(std::function<void()> task, Priority priority = Normal);
+
+    // Run one pending High task on the calling thread. Lets a producer that
+    // waits for back-pressure help the stage it is waiting on.
+    bool helpOne();
+
+    // Block (helping out) until every submitted task finished
+    void waitIdle();
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> high;
+        std::deque<std::function<void()>> normal;
+    };
+
+    void run(int self);
+    bool pop(int self, bool highOnly, std::function<void()> &task);
+    void execute(std::function<void()> &task);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCond_;
+    std::condition_variable idleCond_;
+    std::atomic<int> queued_{0};      // sitting in a deque
+    std::atomic<int> pending_{0};     // submitted, not finished
+    std::atomic<unsigned> nextQueue_{0};
+    bool stop_ = false;
+};
+
+#endif // WORKSTEALINGPOOL_H